@@ -0,0 +1,141 @@
+﻿#ifndef __ASIO_BENCH_H__
+#define __ASIO_BENCH_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio/asio_histogram.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ik::bench
+{
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * @brief Per-batch state handed to a benchmark body.
+     * @note The body runs `iterations` operations. The clock starts right before the body is called;
+     *       setup and teardown that should not be measured go between `resume()` and `pause()`.
+     */
+    struct state
+    {
+        std::size_t                                     iterations = 1;
+        clock_type::time_point                          start;
+        clock_type::time_point                          end;
+        bool                                            paused = false;
+
+        /**
+         * @brief Restart the clock, e.g. after the fixture of the batch has been set up.
+         */
+        void resume()
+        {
+            paused = false, start = clock_type::now();
+        }
+
+        /**
+         * @brief Stop the clock, e.g. before the fixture of the batch is torn down.
+         */
+        void pause()
+        {
+            paused = true, end = clock_type::now();
+        }
+    };
+
+    struct benchmark
+    {
+        std::string                                     name;
+        std::function<void(state&)>                     body;
+    };
+
+    inline std::vector<benchmark>& registry()
+    {
+        static std::vector<benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    struct registrar
+    {
+        registrar(std::string name, std::function<void(state&)> body)
+        {
+            registry().emplace_back(benchmark{ std::move(name), std::move(body) });
+        }
+    };
+
+    /**
+     * @brief Run every registered benchmark whose name contains `filter`.
+     * @param filter - Substring the benchmark name must contain, empty to run everything.
+     * @param min_time - The minimum measured time per benchmark.
+     * @note Each benchmark is first calibrated so that one batch takes about `batch_time`, the calibration batches
+     *       are discarded. The nanoseconds per operation of every following batch go into a histogram and one JSON
+     *       object per benchmark is written to stdout, so the output can be appended to a JSON-lines history file.
+     */
+    inline void run(const std::string& filter, const std::chrono::milliseconds& min_time)
+    {
+        constexpr clock_type::duration batch_time = std::chrono::milliseconds(10);
+
+        for (const benchmark& item : registry())
+        {
+            if (item.name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+
+            auto measure = [&item] (std::size_t iterations) {
+                state st;
+                st.iterations = iterations;
+                st.start = clock_type::now();
+                item.body(st);
+                return (st.paused ? st.end : clock_type::now()) - st.start;
+            };
+
+            // Calibrate: grow the batch until it takes long enough to time reliably.
+            std::size_t iterations = 1;
+
+            for (clock_type::duration elapsed = measure(iterations); elapsed < batch_time && iterations < (static_cast<std::size_t>(1) << 30); )
+            {
+                std::size_t factor = elapsed.count() > 0 ? static_cast<std::size_t>(batch_time / elapsed) + 1 : 10;
+                iterations *= factor < 2 ? 2 : (factor > 10 ? 10 : factor);
+                elapsed = measure(iterations);
+            }
+
+            asio_histogram samples;
+            std::uint64_t batches = 0;
+            clock_type::duration total{};
+
+            for (; total < min_time || batches < 5; ++batches)
+            {
+                clock_type::duration elapsed = measure(iterations);
+                total += elapsed;
+                samples.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::duration<double, std::pico>>(elapsed).count() / static_cast<double>(iterations)));
+            }
+
+            double ns_per_op = std::chrono::duration<double, std::nano>(total).count() / static_cast<double>(batches * iterations);
+
+            printf("{\"name\":\"%s\",\"batches\":%llu,\"iterations\":%zu,\"ns_per_op\":%.3f,\"ops_per_s\":%.0f,\"min_ns\":%.3f,\"p50_ns\":%.3f,\"p99_ns\":%.3f,\"max_ns\":%.3f}\n",
+                   item.name.c_str(), static_cast<unsigned long long>(batches), iterations, ns_per_op, 1e9 / ns_per_op,
+                   static_cast<double>(samples.min()) / 1000.0, static_cast<double>(samples.percentile(0.5)) / 1000.0,
+                   static_cast<double>(samples.percentile(0.99)) / 1000.0, static_cast<double>(samples.max()) / 1000.0);
+            fflush(stdout);
+        }
+    }
+}
+
+#define ASIO_BENCH_CONCAT_IMPL(a, b) a##b
+#define ASIO_BENCH_CONCAT(a, b) ASIO_BENCH_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Register a benchmark body under a name.
+ * @example
+ * ASIO_BENCHMARK("binder/notify/recv", [] (ik::bench::state& state) {
+ *     for (std::size_t i = 0; i < state.iterations; ++i) { ... }
+ * });
+ */
+#define ASIO_BENCHMARK(name, ...) static ik::bench::registrar ASIO_BENCH_CONCAT(asio_bench_registrar_, __LINE__)(name, __VA_ARGS__)
+
+#endif // __ASIO_BENCH_H__
\ No newline at end of file
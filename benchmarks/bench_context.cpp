@@ -0,0 +1,96 @@
+﻿#include "asio_bench.hpp"
+#include "asio_event.hpp"
+
+namespace
+{
+    using namespace ik;
+
+    std::uint64_t sink = 0;
+
+    /**
+     * @brief Thread pool shared by the selection benchmarks.
+     * @note Intentionally leaked, the pool threads are not joined on shutdown.
+     */
+    asio_context_thread_pool& pool()
+    {
+        static asio_context* io_context = new asio_context();
+        static asio_context_thread_pool* group = [] {
+            asio_context_thread_pool* group = new asio_context_thread_pool(*io_context);
+            group->init(4);
+            return group;
+        }();
+        return *group;
+    }
+
+    ASIO_BENCHMARK("context/get_context_idx/4", [] (bench::state& state) {
+        asio_context_thread_pool& group = pool();
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            sink += group.get_context_idx();
+        }
+    });
+
+    ASIO_BENCHMARK("context/get_context/4", [] (bench::state& state) {
+        asio_context_thread_pool& group = pool();
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            sink += reinterpret_cast<std::uintptr_t>(&group.get_context());
+        }
+    });
+
+    /**
+     * @brief Arm a long timer and cancel it again, including the resumption of the waiting coroutine.
+     */
+    ASIO_BENCHMARK("timer/arm_cancel", [] (bench::state& state) {
+        static asio_context io_context;
+        static asio_steady_timer timer(io_context);
+        std::size_t wakeups = 0;
+
+        asio::co_spawn(io_context, [&] () -> asio::awaitable<void> {
+            asio::error_code ec;
+
+            for (std::size_t i = 0; i < state.iterations; ++i, ++wakeups)
+            {
+                co_await timer.async_wait(std::chrono::hours(1), asio::redirect_error(asio::use_awaitable, ec));
+            }
+        }, asio::detached);
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            io_context.poll();
+            timer.cancel();
+        }
+
+        while (wakeups < state.iterations)
+        {
+            io_context.run_one();
+        }
+    });
+
+    /**
+     * @brief Arm a timer that is already due and wait for it to fire.
+     */
+    ASIO_BENCHMARK("timer/arm_expire", [] (bench::state& state) {
+        static asio_context io_context;
+        static asio_steady_timer timer(io_context);
+        bool done = false;
+
+        asio::co_spawn(io_context, [&] () -> asio::awaitable<void> {
+            asio::error_code ec;
+
+            for (std::size_t i = 0; i < state.iterations; ++i)
+            {
+                co_await timer.async_wait(std::chrono::steady_clock::duration::zero(), asio::redirect_error(asio::use_awaitable, ec));
+            }
+
+            done = true;
+        }, asio::detached);
+
+        while (!done)
+        {
+            io_context.run_one();
+        }
+    });
+}
\ No newline at end of file
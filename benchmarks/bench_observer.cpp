@@ -0,0 +1,209 @@
+﻿#include "asio_bench.hpp"
+#include "asio_event.hpp"
+
+namespace
+{
+    using namespace ik;
+
+    std::uint64_t sink = 0;
+
+    /**
+     * @brief Objects the observers are notified with, arguments are passed with the exact types the handlers take.
+     */
+    struct fixture
+    {
+        fixture()
+            : socket(io_context)
+            , session(io_context, binder, socket, 0)
+        {
+            binder | std::make_pair(bind_type::init, [] (asio_context& context) { ++sink; });
+            binder | std::make_pair(bind_type::stop, [] (asio_context& context) { ++sink; });
+            binder | std::make_pair(bind_type::recv, [] (asio_context& context, asio_session& session, const char* buf, std::size_t n) { sink += n; });
+            binder | std::make_pair(bind_type::send, [] (asio_context& context, asio_session& session, std::size_t n, asio_error& ec) { sink += n; });
+            binder | std::make_pair(bind_type::writer, [] (asio_context& context, asio_session& session, std::size_t n, asio_error& ec) { sink += n; });
+            binder | std::make_pair(bind_type::connect, [] (asio_context& context, asio_socket& socket, asio_error& ec) { ++sink; });
+            binder | std::make_pair(bind_type::connect_timeout, [] (asio_context& context, asio_socket& socket, asio_error& ec) { ++sink; });
+            binder | std::make_pair(bind_type::disconnect, [] (asio_context& context, asio_session& session, asio_error& ec) { ++sink; });
+            binder | std::make_pair(bind_type::accept, [] (asio_context& context, asio_socket& socket, asio_error& ec) { ++sink; });
+        }
+
+        void notify(bind_type e)
+        {
+            switch (e)
+            {
+            case bind_type::init:
+            case bind_type::stop:
+                binder.notify(e, io_context);
+                break;
+            case bind_type::recv:
+                binder.notify(e, io_context, session, static_cast<const char*>(data), sizeof(data));
+                break;
+            case bind_type::send:
+            case bind_type::writer:
+                binder.notify(e, io_context, session, sizeof(data), ec);
+                break;
+            case bind_type::connect:
+            case bind_type::connect_timeout:
+            case bind_type::accept:
+                binder.notify(e, io_context, socket, ec);
+                break;
+            case bind_type::disconnect:
+                binder.notify(e, io_context, session, ec);
+                break;
+            default:
+                binder.notify(e, io_context);
+                break;
+            }
+        }
+
+        asio::awaitable<void> async_notify(bind_type e, std::size_t iterations)
+        {
+            for (std::size_t i = 0; i < iterations; ++i)
+            {
+                switch (e)
+                {
+                case bind_type::init:
+                case bind_type::stop:
+                    co_await binder.async_notify(e, io_context);
+                    break;
+                case bind_type::recv:
+                    co_await binder.async_notify(e, io_context, session, static_cast<const char*>(data), sizeof(data));
+                    break;
+                case bind_type::send:
+                case bind_type::writer:
+                    co_await binder.async_notify(e, io_context, session, sizeof(data), ec);
+                    break;
+                case bind_type::connect:
+                case bind_type::connect_timeout:
+                case bind_type::accept:
+                    co_await binder.async_notify(e, io_context, socket, ec);
+                    break;
+                case bind_type::disconnect:
+                    co_await binder.async_notify(e, io_context, session, ec);
+                    break;
+                default:
+                    co_await binder.async_notify(e, io_context);
+                    break;
+                }
+            }
+        }
+
+        asio_context                                    io_context;
+        asio_socket                                     socket;
+        asio_binder                                     binder;
+        asio_session                                    session;
+        asio_error                                      ec;
+        char                                            data[64] = { 0 };
+    };
+
+    fixture& instance()
+    {
+        static fixture f;
+        return f;
+    }
+
+    template <typename F>
+    auto make_observer(F&& val)
+    {
+        return observer<typename details::function_traits_cvref<std::decay_t<F>>::type>(std::forward<F>(val));
+    }
+
+    struct target
+    {
+        void handle(std::size_t n)
+        {
+            sink += n;
+        }
+    };
+
+    void handle(std::size_t n)
+    {
+        sink += n;
+    }
+
+    struct binder_benchmarks
+    {
+        binder_benchmarks()
+        {
+            const std::pair<const char*, bind_type> events[] =
+            {
+                { "init", bind_type::init },
+                { "stop", bind_type::stop },
+                { "recv", bind_type::recv },
+                { "send", bind_type::send },
+                { "writer", bind_type::writer },
+                { "connect", bind_type::connect },
+                { "connect_timeout", bind_type::connect_timeout },
+                { "disconnect", bind_type::disconnect },
+                { "accept", bind_type::accept },
+                { "migrate", bind_type::migrate },
+                { "unbound", bind_type::max },
+            };
+
+            for (const auto& [name, e] : events)
+            {
+                bench::registry().emplace_back(bench::benchmark{ std::string("binder/notify/") + name, [e = e] (bench::state& state) {
+                    fixture& f = instance();
+
+                    for (std::size_t i = 0; i < state.iterations; ++i)
+                    {
+                        f.notify(e);
+                    }
+                } });
+
+                bench::registry().emplace_back(bench::benchmark{ std::string("binder/async_notify/") + name, [e = e] (bench::state& state) {
+                    fixture& f = instance();
+                    bool done = false;
+
+                    asio::co_spawn(f.io_context, [&] () -> asio::awaitable<void> {
+                        co_await f.async_notify(e, state.iterations);
+                        done = true;
+                    }, asio::detached);
+
+                    while (!done)
+                    {
+                        f.io_context.run_one();
+                    }
+                } });
+            }
+        }
+    } binder_benchmarks;
+
+    ASIO_BENCHMARK("observer/call/lambda", [] (bench::state& state) {
+        static auto o = make_observer([] (std::size_t n) { sink += n; });
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            o.call(static_cast<std::size_t>(i));
+        }
+    });
+
+    ASIO_BENCHMARK("observer/call/bind", [] (bench::state& state) {
+        static target t;
+        static auto o = make_observer(std::bind(&target::handle, &t, std::placeholders::_1));
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            o.call(static_cast<std::size_t>(i));
+        }
+    });
+
+    ASIO_BENCHMARK("observer/call/function", [] (bench::state& state) {
+        static auto o = make_observer(&handle);
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            o.call(static_cast<std::size_t>(i));
+        }
+    });
+
+    // Baseline for the observer call path.
+    ASIO_BENCHMARK("std_function/call", [] (bench::state& state) {
+        static std::function<void(std::size_t)> fn = [] (std::size_t n) { sink += n; };
+
+        for (std::size_t i = 0; i < state.iterations; ++i)
+        {
+            fn(i);
+        }
+    });
+}
\ No newline at end of file
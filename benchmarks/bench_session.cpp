@@ -0,0 +1,155 @@
+﻿#include "asio_bench.hpp"
+#include "asio_event.hpp"
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#endif
+
+namespace
+{
+    using namespace ik;
+
+    /**
+     * @brief Two sessions connected back to back on one context.
+     * @note A Unix socketpair is used where available so the numbers exclude the TCP stack, Windows falls back to loopback TCP.
+     */
+    struct session_pair
+    {
+        explicit session_pair(bool echo)
+            : echo(echo)
+        {
+            asio_socket a(io_context), b(io_context);
+
+#if defined(_WIN32)
+            asio_acceptor acceptor(io_context, asio_endpoint(asio::ip::address_v4::loopback(), 0));
+            a.connect(acceptor.local_endpoint());
+            acceptor.accept(b);
+#else
+            int fds[2] = { -1, -1 };
+
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            {
+                throw asio::error_code(errno, asio::error::get_system_category());
+            }
+
+            a.assign(asio::ip::tcp::v4(), fds[0]);
+            b.assign(asio::ip::tcp::v4(), fds[1]);
+#endif
+
+            using namespace std::placeholders;
+            client_binder | std::make_pair(bind_type::recv, std::bind(&session_pair::client_recv, this, _1, _2, _3, _4));
+            server_binder | std::make_pair(bind_type::recv, std::bind(&session_pair::server_recv, this, _1, _2, _3, _4));
+
+            (client = std::make_shared<asio_session>(io_context, client_binder, a, 0))->init();
+            (server = std::make_shared<asio_session>(io_context, server_binder, b, 1))->init();
+        }
+        ~session_pair()
+        {
+            client->close();
+            server->close();
+
+            // Let the reader and writer coroutines observe the close and release their references.
+            while ((client.use_count() > 1 || server.use_count() > 1) && io_context.run_one_for(std::chrono::milliseconds(100)))
+            {
+            }
+        }
+
+        void client_recv(asio_context& context, asio_session& session, const char* buf, std::size_t n)
+        {
+            client_bytes += n;
+
+            if (on_client)
+            {
+                on_client();
+            }
+        }
+
+        void server_recv(asio_context& context, asio_session& session, const char* buf, std::size_t n)
+        {
+            server_bytes += n;
+
+            if (echo)
+            {
+                server->async_send(std::string_view(buf, n));
+            }
+
+            if (on_server)
+            {
+                on_server();
+            }
+        }
+
+        asio_context                                    io_context;
+        asio_binder                                     client_binder;
+        asio_binder                                     server_binder;
+        std::shared_ptr<asio_session>                   client;
+        std::shared_ptr<asio_session>                   server;
+        std::function<void()>                           on_client;
+        std::function<void()>                           on_server;
+        std::size_t                                     client_bytes = 0;
+        std::size_t                                     server_bytes = 0;
+        bool                                            echo;
+    };
+
+    /**
+     * @brief Push `iterations` messages through `async_writer` and the writer coroutine, keeping at most `window` queued.
+     */
+    void writer_throughput(bench::state& state, std::size_t size, std::size_t window)
+    {
+        session_pair pair(false);
+        std::string payload(size, 'x');
+        std::size_t sent = 0;
+
+        auto pump = [&] {
+            for (; sent < state.iterations && sent - pair.server_bytes / size < window; ++sent)
+            {
+                pair.client->async_writer(payload);
+            }
+        };
+
+        pair.on_server = pump;
+        state.resume();
+
+        asio::post(pair.io_context, pump);
+
+        while (pair.server_bytes < state.iterations * size)
+        {
+            pair.io_context.run_one();
+        }
+
+        state.pause();
+    }
+
+    /**
+     * @brief Send one message with `async_send` and wait for the echo before sending the next.
+     */
+    void send_round_trip(bench::state& state, std::size_t size)
+    {
+        session_pair pair(true);
+        std::string payload(size, 'x');
+        std::size_t done = 0;
+
+        pair.on_client = [&] {
+            if (pair.client_bytes >= (done + 1) * size && ++done < state.iterations)
+            {
+                pair.client->async_send(payload);
+            }
+        };
+
+        state.resume();
+
+        asio::post(pair.io_context, [&] { pair.client->async_send(payload); });
+
+        while (done < state.iterations)
+        {
+            pair.io_context.run_one();
+        }
+
+        state.pause();
+    }
+
+    ASIO_BENCHMARK("session/async_writer/64", [] (bench::state& state) { writer_throughput(state, 64, 64); });
+    ASIO_BENCHMARK("session/async_writer/4096", [] (bench::state& state) { writer_throughput(state, 4096, 64); });
+    ASIO_BENCHMARK("session/async_send/round_trip/64", [] (bench::state& state) { send_round_trip(state, 64); });
+    ASIO_BENCHMARK("session/async_send/round_trip/4096", [] (bench::state& state) { send_round_trip(state, 4096); });
+}
\ No newline at end of file
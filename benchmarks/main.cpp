@@ -0,0 +1,40 @@
+﻿#include "asio_bench.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    std::chrono::milliseconds min_time(500);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            min_time = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--list") == 0)
+        {
+            for (const auto& item : ik::bench::registry())
+            {
+                printf("%s\n", item.name.c_str());
+            }
+
+            return 0;
+        }
+        else
+        {
+            printf("usage: %s [--filter SUBSTRING] [--min-time MS] [--list]\n"
+                   "  Prints one JSON object per benchmark, append the output to a .jsonl file to track releases.\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ik::bench::run(filter, min_time);
+    return 0;
+}
\ No newline at end of file
@@ -1,6 +1,335 @@
 ﻿#include "asio_event.hpp"
 
-int main()
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
 {
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * @brief Command line options of the load generator.
+     */
+    struct options
+    {
+        std::string                                     host = "127.0.0.1";
+        std::string                                     port = "6666";
+        std::size_t                                     connections = 16;
+        std::size_t                                     contexts = 4;
+        std::size_t                                     size_min = 64;
+        std::size_t                                     size_max = 64;
+        std::string                                     size_dist = "uniform";
+        double                                          rate = 0;                           // open loop, messages per second (all connections)
+        std::size_t                                     concurrency = 1;                    // closed loop, outstanding messages per connection
+        std::size_t                                     duration = 10;                      // seconds
+    };
+
+    struct request
+    {
+        clock_type::time_point                          start;
+        std::size_t                                     remaining;
+    };
+
+    /**
+     * @brief State of one connection, only touched from the context the connection runs on.
+     */
+    struct connection
+    {
+        std::shared_ptr<ik::asio_session>               session;
+        std::deque<request>                             pending;
+        std::mt19937_64                                 engine{ std::random_device{}() };
+        ik::asio_histogram                              latency;
+    };
+
+    void usage(const char* name)
+    {
+        printf("usage: %s [--host 127.0.0.1] [--port 6666] [--connections 16] [--contexts 4]\n"
+               "          [--size 64 | --size MIN:MAX] [--size-dist uniform|exp]\n"
+               "          [--rate MSG_PER_SEC | --concurrency N] [--duration SEC]\n"
+               "\n"
+               "  --rate        open loop: send at a fixed total rate, latency is measured from the intended send time\n"
+               "  --concurrency closed loop: keep N messages in flight per connection (default 1)\n"
+               "  The target must echo every byte back (asio_tcp_server does).\n", name);
+    }
+
+    bool parse(int argc, char* argv[], options& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string key = argv[i];
+            const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+
+            if (key == "--help" || key == "-h" || val == nullptr)
+            {
+                return false;
+            }
+
+            if (key == "--host") opt.host = val;
+            else if (key == "--port") opt.port = val;
+            else if (key == "--connections") opt.connections = std::strtoull(val, nullptr, 10);
+            else if (key == "--contexts") opt.contexts = std::strtoull(val, nullptr, 10);
+            else if (key == "--size-dist") opt.size_dist = val;
+            else if (key == "--rate") opt.rate = std::strtod(val, nullptr);
+            else if (key == "--concurrency") opt.concurrency = std::strtoull(val, nullptr, 10);
+            else if (key == "--duration") opt.duration = std::strtoull(val, nullptr, 10);
+            else if (key == "--size")
+            {
+                const char* sep = std::strchr(val, ':');
+                opt.size_min = std::strtoull(val, nullptr, 10);
+                opt.size_max = sep ? std::strtoull(sep + 1, nullptr, 10) : opt.size_min;
+            }
+            else
+            {
+                return false;
+            }
+
+            ++i;
+        }
+
+        return opt.connections && opt.contexts && opt.size_min && opt.size_min <= opt.size_max && (opt.rate > 0 || opt.concurrency);
+    }
+
+    class load_generator
+    {
+    public:
+        explicit load_generator(ik::asio_context& io_context, const options& opt)
+            : io_context(io_context)
+            , io_group(io_context)
+            , opt(opt)
+            , payload(opt.size_max, 'x')
+            , running(true)
+            , connected(0)
+            , sent(0)
+            , received(0)
+            , bytes(0)
+        {
+            using namespace std::placeholders;
+            binder | std::make_pair(ik::bind_type::connect, std::bind(&load_generator::connect, this, _1, _2, _3));
+            binder | std::make_pair(ik::bind_type::recv, std::bind(&load_generator::receive, this, _1, _2, _3, _4));
+            binder | std::make_pair(ik::bind_type::disconnect, std::bind(&load_generator::leave, this, _1, _2, _3));
+
+            for (std::size_t i = 0; i < opt.connections; ++i)
+            {
+                conns.emplace_back(std::make_unique<connection>());
+            }
+        }
+    public:
+        void start()
+        {
+            io_group.init(opt.contexts);
+            deadline = clock_type::now() + std::chrono::seconds(opt.duration);
+
+            for (std::size_t i = 0; i < opt.connections; ++i)
+            {
+                clients.emplace_back(std::make_shared<ik::asio_tcp_client>(io_group.get_context(), binder))->async_connect_resolver(opt.host, opt.port);
+            }
+
+            asio::co_spawn(io_context, report(), asio::detached);
+        }
+
+        void stop()
+        {
+            io_group.stop();
+        }
+    private:
+        void connect(ik::asio_context& context, ik::asio_socket& socket, ik::asio_error& ec)
+        {
+            if (ec)
+            {
+                printf("connect failed: %s\n", ec.message().c_str());
+                return;
+            }
+
+            std::size_t id = connected.fetch_add(1);
+            connection& conn = *conns[id];
+
+            (conn.session = std::make_shared<ik::asio_session>(context, binder, socket, id))->init();
+
+            if (opt.rate > 0)
+            {
+                asio::co_spawn(context, open_loop(conn), asio::detached);
+            }
+            else
+            {
+                for (std::size_t i = 0; i < opt.concurrency; ++i)
+                {
+                    send(conn, clock_type::now());
+                }
+            }
+        }
+
+        void receive(ik::asio_context& context, ik::asio_session& session, const char* buf, std::size_t n)
+        {
+            connection& conn = *conns[session.index()];
+            clock_type::time_point now = clock_type::now();
+
+            bytes.fetch_add(n, std::memory_order_relaxed);
+
+            while (n && !conn.pending.empty())
+            {
+                request& front = conn.pending.front();
+                std::size_t used = std::min(n, front.remaining);
+
+                if (n -= used, front.remaining -= used; front.remaining == 0)
+                {
+                    conn.latency.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - front.start).count()));
+                    conn.pending.pop_front();
+                    received.fetch_add(1, std::memory_order_relaxed);
+
+                    // Closed loop: every completed round trip releases the next message.
+                    if (opt.rate <= 0 && running.load(std::memory_order_relaxed))
+                    {
+                        send(conn, now);
+                    }
+                }
+            }
+        }
+
+        void leave(ik::asio_context& context, ik::asio_session& session, ik::asio_error& ec)
+        {
+            if (running.load())
+            {
+                printf("connection %zu closed: %s\n", session.index(), ec.message().c_str());
+            }
+        }
+
+        void send(connection& conn, clock_type::time_point start)
+        {
+            std::size_t n = opt.size_min;
+
+            if (opt.size_max > opt.size_min)
+            {
+                if (opt.size_dist == "exp")
+                {
+                    double mean = static_cast<double>(opt.size_min + opt.size_max) / 2.0;
+                    n = static_cast<std::size_t>(std::exponential_distribution<double>(1.0 / mean)(conn.engine));
+                    n = std::clamp(n, opt.size_min, opt.size_max);
+                }
+                else
+                {
+                    n = std::uniform_int_distribution<std::size_t>(opt.size_min, opt.size_max)(conn.engine);
+                }
+            }
+
+            conn.pending.push_back(request{ start, n });
+            conn.session->async_writer(std::string_view(payload.data(), n));
+            sent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Coroutine sending on a fixed schedule, independent of how fast responses arrive.
+         * @note Latency is measured from the scheduled send time, so a stalled server is not hidden by a stalled sender.
+         */
+        asio::awaitable<void> open_loop(connection& conn)
+        {
+            asio::error_code ec;
+            asio::steady_timer timer(co_await asio::this_coro::executor);
+            clock_type::duration interval = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(static_cast<double>(opt.connections) / opt.rate));
+
+            for (clock_type::time_point next = clock_type::now(); running.load(std::memory_order_relaxed) && conn.session->is_open(); )
+            {
+                timer.expires_at(next);
+                co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+
+                for (clock_type::time_point now = clock_type::now(); next <= now; next += interval)
+                {
+                    send(conn, next);
+                }
+            }
+        }
+
+        asio::awaitable<void> report()
+        {
+            asio::error_code ec;
+            asio::steady_timer timer(io_context);
+            std::uint64_t last_received = 0, last_bytes = 0;
+            clock_type::time_point begin = clock_type::now();
+
+            for (std::size_t second = 1; clock_type::now() < deadline; ++second)
+            {
+                timer.expires_at(begin + std::chrono::seconds(second));
+                co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+
+                std::uint64_t cur_received = received.load(), cur_bytes = bytes.load();
+                printf("[%3zus] conns %zu  msg/s %10llu  MB/s %8.2f  inflight %llu\n",
+                       second, connected.load(),
+                       static_cast<unsigned long long>(cur_received - last_received),
+                       static_cast<double>(cur_bytes - last_bytes) / (1024.0 * 1024.0),
+                       static_cast<unsigned long long>(sent.load() - cur_received));
+                last_received = cur_received, last_bytes = cur_bytes;
+            }
+
+            // Stop sending and give the outstanding responses a moment to drain.
+            running.store(false);
+            double elapsed = std::chrono::duration<double>(clock_type::now() - begin).count();
+            timer.expires_after(std::chrono::seconds(1));
+            co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+
+            summary(elapsed);
+            io_context.asio::io_context::stop();
+        }
+
+        void summary(double elapsed)
+        {
+            ik::asio_histogram total;
+
+            for (const auto& conn : conns)
+            {
+                total.merge(conn->latency);
+            }
+
+            auto us = [&] (double q) { return static_cast<double>(total.percentile(q)) / 1000.0; };
+
+            printf("\nsent %llu  received %llu  elapsed %.2fs  throughput %.0f msg/s  %.2f MB/s\n",
+                   static_cast<unsigned long long>(sent.load()), static_cast<unsigned long long>(received.load()), elapsed,
+                   static_cast<double>(received.load()) / elapsed, static_cast<double>(bytes.load()) / elapsed / (1024.0 * 1024.0));
+            printf("latency us  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  mean %.1f\n",
+                   static_cast<double>(total.min()) / 1000.0, us(0.5), us(0.9), us(0.99), us(0.999), static_cast<double>(total.max()) / 1000.0, total.mean() / 1000.0);
+            printf("{\"sent\":%llu,\"received\":%llu,\"elapsed_s\":%.3f,\"msg_per_s\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}\n",
+                   static_cast<unsigned long long>(sent.load()), static_cast<unsigned long long>(received.load()), elapsed,
+                   static_cast<double>(received.load()) / elapsed, us(0.5), us(0.99), us(0.999), static_cast<double>(total.max()) / 1000.0);
+            fflush(stdout);
+        }
+    private:
+        ik::asio_context&                                                      io_context;
+        ik::asio_context_thread_pool                                           io_group;
+        ik::asio_binder                                                        binder;
+        options                                                                opt;
+        std::string                                                            payload;
+        std::vector<std::shared_ptr<ik::asio_tcp_client>>                      clients;
+        std::vector<std::unique_ptr<connection>>                               conns;
+        clock_type::time_point                                                 deadline;
+        std::atomic_bool                                                       running;
+        std::atomic_size_t                                                     connected;
+        std::atomic_uint64_t                                                   sent;
+        std::atomic_uint64_t                                                   received;
+        std::atomic_uint64_t                                                   bytes;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace ik;
+
+    options opt;
+
+    if (!parse(argc, argv, opt))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    asio_context io_context;
+    load_generator generator(io_context, opt);
+    generator.start();
+    io_context.run();
+    generator.stop();
+
     return 0;
 }
\ No newline at end of file
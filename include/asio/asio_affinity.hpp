@@ -0,0 +1,160 @@
+﻿#ifndef __ASIO_AFFINITY_H__
+#define __ASIO_AFFINITY_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_context_thread_pool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ik
+{
+    /**
+     * @brief Maps keys (tenants, users, shards) to the contexts of a pool with consistent hashing, and moves sessions there.
+     * @note Every context owns `replicas` points on a hash ring, a key belongs to the context of the first point after
+     *       its hash. When an autoscaling pool adds or drains a context, only the keys of the ring segments it gains
+     *       or loses change owner. Sessions of the same key end up on the same context and share its caches.
+     * @example
+     * asio_affinity affinity(server->get_group());
+     * binder.add(bind_type::recv, [&](asio_context&, asio_session& session, const char* data, std::size_t n)
+     * {
+     *     // Once the first message names the tenant, move the session to the tenant's context.
+     *     affinity.assign(session, parse_tenant(data, n));
+     * });
+     * binder.add(bind_type::migrate, [&](asio_context&, asio_session& session, asio_error& ec)
+     * {
+     *     (sessions[session.index()] = std::make_shared<asio_session>(std::move(session)))->init();
+     * });
+     */
+    class asio_affinity
+    {
+    public:
+        explicit asio_affinity(asio_context_thread_pool& pool, std::size_t replicas = 64)
+            : pool(pool)
+            , replicas(replicas ? replicas : 1)
+        {
+        }
+        virtual ~asio_affinity() = default;
+    private:
+        asio_affinity(const asio_affinity&) = delete;
+        asio_affinity& operator=(const asio_affinity&) = delete;
+    public:
+        /**
+         * @brief Get the context owning a key.
+         * @param key - The key.
+         * @return Returns the context, or the pool's parent context if the pool has none taking sessions.
+         */
+        asio_context& owner(const std::string_view& key)
+        {
+            return pool.get_context(owner_idx(key));
+        }
+
+        /**
+         * @brief Get the index of the context owning a key, with the same meaning as for `asio_context_thread_pool::get_context(std::size_t)`.
+         */
+        std::size_t owner_idx(const std::string_view& key)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (refresh(), ring.empty())
+            {
+                return static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()) + 1;
+            }
+
+            std::uint64_t point = hash(key);
+            auto it = std::lower_bound(ring.begin(), ring.end(), point, [] (const std::pair<std::uint64_t, std::size_t>& node, std::uint64_t value) {
+                return node.first < value;
+            });
+
+            return (it == ring.end() ? ring.front() : *it).second;
+        }
+
+        /**
+         * @brief Move a session to the context owning its key, if it is not there already.
+         * @param session - The session, a stream session that can `migrate`.
+         * @param key - The key identifying the session.
+         * @return Returns `true` if the session is being moved, the moved session then arrives through `bind_type::migrate`.
+         */
+        template <typename Session>
+        bool assign(Session& session, const std::string_view& key)
+        {
+            asio_context& target = owner(key);
+
+            if (std::addressof(target) == std::addressof(session.get_context()))
+            {
+                return false;
+            }
+
+            session.migrate(target);
+            return true;
+        }
+    private:
+        /**
+         * @brief Rebuild the ring if the contexts taking sessions changed since the last call.
+         */
+        void refresh()
+        {
+            std::vector<std::size_t> indices = pool.get_context_indices();
+
+            if (indices == members)
+            {
+                return;
+            }
+
+            ring.clear(), ring.reserve(indices.size() * replicas);
+
+            for (std::size_t idx : indices)
+            {
+                for (std::size_t i = 0; i < replicas; ++i)
+                {
+                    ring.emplace_back(mix((static_cast<std::uint64_t>(idx) << 32) | i), idx);
+                }
+            }
+
+            std::sort(ring.begin(), ring.end());
+            members = std::move(indices);
+        }
+
+        /**
+         * @brief FNV-1a over the key, spread over the ring by `mix`.
+         */
+        static std::uint64_t hash(const std::string_view& key) noexcept
+        {
+            std::uint64_t h = 14695981039346656037ull;
+
+            for (unsigned char c : key)
+            {
+                h = (h ^ c) * 1099511628211ull;
+            }
+
+            return mix(h);
+        }
+
+        /**
+         * @brief The splitmix64 finalizer.
+         */
+        static std::uint64_t mix(std::uint64_t x) noexcept
+        {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+    private:
+        asio_context_thread_pool&                       pool;
+        std::size_t                                     replicas;
+        std::mutex                                      mutex;
+        std::vector<std::size_t>                        members;
+        std::vector<std::pair<std::uint64_t, std::size_t>> ring;
+    };
+}
+
+#endif // __ASIO_AFFINITY_H__
\ No newline at end of file
@@ -0,0 +1,56 @@
+﻿#ifndef __ASIO_BACKOFF_H__
+#define __ASIO_BACKOFF_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace ik
+{
+    /**
+     * @brief Exponential backoff with full jitter for reconnect loops.
+     * @note The n-th retry waits a uniformly random delay in `[0, min(cap, base * 2^n)]`, which spreads reconnect
+     *       storms of many clients instead of having them hit a recovering backend in lockstep.
+     */
+    struct asio_backoff
+    {
+        std::chrono::milliseconds                       base{ 100 };
+        std::chrono::milliseconds                       cap{ 30000 };
+        std::size_t                                     attempts{ 1 };                      // 0 = unlimited
+
+        /**
+         * @brief Compute the delay before the retry following `n` consecutive failures.
+         * @param n - The number of consecutive failures so far (starting at 0).
+         * @return Returns the jittered delay in milliseconds.
+         */
+        std::chrono::milliseconds delay(std::size_t n) const
+        {
+            thread_local std::mt19937_64 engine(std::random_device{}());
+
+            std::int64_t ceiling = cap.count();
+
+            if (n < 62 && base.count() <= (cap.count() >> n))
+            {
+                ceiling = base.count() << n;
+            }
+
+            return std::chrono::milliseconds(std::uniform_int_distribution<std::int64_t>(0, ceiling)(engine));
+        }
+
+        /**
+         * @brief Check whether another attempt is allowed after `n` consecutive failures.
+         * @param n - The number of consecutive failures so far.
+         * @return Returns `true` if the policy allows another attempt, otherwise `false`.
+         */
+        bool retry(std::size_t n) const noexcept
+        {
+            return attempts == 0 || n < attempts;
+        }
+    };
+}
+
+#endif // __ASIO_BACKOFF_H__
\ No newline at end of file
@@ -0,0 +1,451 @@
+﻿#ifndef __ASIO_COMPRESSION_H__
+#define __ASIO_COMPRESSION_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if __has_include(<lz4.h>)
+#	include <lz4.h>
+#	define ASIO_EVENT_HAS_LZ4 1
+#endif
+
+#if __has_include(<zstd.h>)
+#	include <zstd.h>
+#	define ASIO_EVENT_HAS_ZSTD 1
+#endif
+
+namespace ik
+{
+    enum class compression_type : std::uint8_t
+    {
+        none,
+        lz4,
+        zstd,
+        max
+    };
+
+    /**
+     * @brief Compression settings shared by the sessions that use them.
+     * @note Codecs are only available when their library was found at compile time (`ASIO_EVENT_HAS_LZ4`, `ASIO_EVENT_HAS_ZSTD`).
+     *       Both ends must enable compression on their session; each then compresses with the first codec of its
+     *       preference that the peer announced it can decode. A zstd dictionary, e.g. trained with `zstd --train` on
+     *       sample messages, must be the same on both ends.
+     * @example
+     * auto compression = std::make_shared<asio_compression>();
+     * compression->set_codecs({ compression_type::zstd, compression_type::lz4 }).set_zstd_dictionary(dictionary);
+     * session->set_compression(compression).init();
+     */
+    class asio_compression
+    {
+    public:
+        explicit asio_compression(std::size_t threshold = 1024)
+            : threshold(threshold)
+            , zstd_level(3)
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            , cdict(nullptr)
+            , ddict(nullptr)
+#endif
+        {
+            set_codecs({ compression_type::lz4, compression_type::zstd });
+        }
+        virtual ~asio_compression()
+        {
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            ZSTD_freeCDict(cdict);
+            ZSTD_freeDDict(ddict);
+#endif
+        }
+    private:
+        asio_compression(const asio_compression&) = delete;
+        asio_compression& operator=(const asio_compression&) = delete;
+    public:
+        /**
+         * @brief Set the codecs to compress with, in order of preference. Codecs not compiled in are skipped.
+         */
+        asio_compression& set_codecs(std::initializer_list<compression_type> codecs)
+        {
+            preference.clear();
+
+            for (compression_type codec : codecs)
+            {
+                if (available(codec))
+                {
+                    preference.emplace_back(codec);
+                }
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Set the size from which a message is compressed, smaller messages are sent as they are.
+         */
+        asio_compression& set_threshold(std::size_t n)
+        {
+            threshold = n;
+            return *this;
+        }
+
+        /**
+         * @brief Set the zstd compression level, 1 (fastest) to 19, before the dictionary if one is used.
+         */
+        asio_compression& set_zstd_level(int level)
+        {
+            zstd_level = level;
+            return *this;
+        }
+
+        /**
+         * @brief Use a zstd dictionary, digested once here and shared by all sessions.
+         */
+        asio_compression& set_zstd_dictionary([[maybe_unused]] const std::string_view& dictionary)
+        {
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            ZSTD_freeCDict(cdict), cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), zstd_level);
+            ZSTD_freeDDict(ddict), ddict = ZSTD_createDDict(dictionary.data(), dictionary.size());
+#endif
+            return *this;
+        }
+
+        std::size_t get_threshold() const noexcept
+        {
+            return threshold;
+        }
+
+        int get_zstd_level() const noexcept
+        {
+            return zstd_level;
+        }
+
+        /**
+         * @brief Get the mask of the codecs this build can decode, announced to the peer.
+         */
+        static std::uint8_t decodable() noexcept
+        {
+            std::uint8_t mask = 0;
+
+            for (std::size_t i = 1; i < static_cast<std::size_t>(compression_type::max); ++i)
+            {
+                mask |= available(static_cast<compression_type>(i)) ? static_cast<std::uint8_t>(1u << i) : 0;
+            }
+
+            return mask;
+        }
+
+        /**
+         * @brief Pick the codec to send with, given the mask announced by the peer.
+         */
+        compression_type choose(std::uint8_t peer) const noexcept
+        {
+            for (compression_type codec : preference)
+            {
+                if (peer & (1u << static_cast<std::size_t>(codec)))
+                {
+                    return codec;
+                }
+            }
+
+            return compression_type::none;
+        }
+
+        static constexpr bool available(compression_type codec) noexcept
+        {
+            switch (codec)
+            {
+#if defined(ASIO_EVENT_HAS_LZ4)
+            case compression_type::lz4:
+                return true;
+#endif
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            case compression_type::zstd:
+                return true;
+#endif
+            default:
+                return false;
+            }
+        }
+
+#if defined(ASIO_EVENT_HAS_ZSTD)
+        const ZSTD_CDict* zstd_cdict() const noexcept
+        {
+            return cdict;
+        }
+
+        const ZSTD_DDict* zstd_ddict() const noexcept
+        {
+            return ddict;
+        }
+#endif
+    private:
+        std::vector<compression_type>                   preference;
+        std::size_t                                     threshold;
+        int                                             zstd_level;
+#if defined(ASIO_EVENT_HAS_ZSTD)
+        ZSTD_CDict*                                     cdict;
+        ZSTD_DDict*                                     ddict;
+#endif
+    };
+
+    /**
+     * @brief Framing and compression state of one connection.
+     * @note Every message goes out as one frame: a 10-byte little-endian header (wire size, original size, kind, codec)
+     *       followed by the payload. The first frame of each side is a hello announcing the codecs it decodes; messages
+     *       are sent uncompressed until the peer's hello arrived. Each frame is compressed on its own with contexts kept
+     *       for the connection, so no allocation happens per message once the buffers have grown.
+     */
+    class asio_frame_codec
+    {
+    public:
+        static constexpr std::size_t header_size = 10;
+        static constexpr std::size_t max_frame = 64 * 1024 * 1024;
+
+        enum class frame_kind : std::uint8_t
+        {
+            data,
+            hello
+        };
+    public:
+        explicit asio_frame_codec(std::shared_ptr<const asio_compression> options)
+            : options(std::move(options))
+            , codec(compression_type::none)
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            , cctx(ZSTD_createCCtx())
+            , dctx(ZSTD_createDCtx())
+#endif
+        {
+#if defined(ASIO_EVENT_HAS_LZ4)
+            lz4_state.reset(new char[LZ4_sizeofState()]);
+#endif
+        }
+        virtual ~asio_frame_codec()
+        {
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            ZSTD_freeCCtx(cctx);
+            ZSTD_freeDCtx(dctx);
+#endif
+        }
+    private:
+        asio_frame_codec(const asio_frame_codec&) = delete;
+        asio_frame_codec& operator=(const asio_frame_codec&) = delete;
+    public:
+        /**
+         * @brief Append the hello frame, to be sent before any message.
+         */
+        void hello(std::string& out) const
+        {
+            char mask = static_cast<char>(asio_compression::decodable());
+            append(out, frame_kind::hello, compression_type::none, 1, 1);
+            out.push_back(mask);
+        }
+
+        /**
+         * @brief Append a message as a frame, compressed if it is large enough and compression pays off.
+         * @return Returns `asio::error::message_size` for a message over `max_frame`, which the peer would reject,
+         *         `out` is then left as it was.
+         */
+        asio_error encode(const std::string_view& in, std::string& out)
+        {
+            std::size_t at = out.size();
+
+            if (in.size() > max_frame)
+            {
+                return asio::error::message_size;
+            }
+
+            if (codec != compression_type::none && in.size() >= options->get_threshold())
+            {
+                std::size_t n = 0;
+
+                out.resize(at + header_size + bound(in.size()));
+
+                if ((n = compress(in, out.data() + at + header_size, out.size() - at - header_size)) != 0 && n < in.size())
+                {
+                    out.resize(at + header_size + n);
+                    write_header(out.data() + at, frame_kind::data, codec, n, in.size());
+                    return asio_error();
+                }
+
+                out.resize(at);
+            }
+
+            append(out, frame_kind::data, compression_type::none, in.size(), in.size());
+            out.append(in.data(), in.size());
+            return asio_error();
+        }
+
+        /**
+         * @brief Feed received bytes and hand every complete message to `f(const char*, std::size_t)`.
+         * @return Returns an error for a corrupt or oversized frame, after which the connection cannot be read further.
+         * @note The pointer passed to `f` is only valid during the call.
+         */
+        template <typename F>
+        asio_error decode(const char* data, std::size_t n, F&& f)
+        {
+            inbuf.append(data, n);
+
+            std::size_t pos = 0;
+            asio_error ec;
+
+            for (; inbuf.size() - pos >= header_size; )
+            {
+                const unsigned char* h = reinterpret_cast<const unsigned char*>(inbuf.data() + pos);
+                std::size_t wire = load32(h), raw = load32(h + 4);
+                frame_kind kind = static_cast<frame_kind>(h[8]);
+                compression_type type = static_cast<compression_type>(h[9]);
+
+                if (wire > max_frame || raw > max_frame)
+                {
+                    ec = asio::error::message_size;
+                    break;
+                }
+
+                if (inbuf.size() - pos < header_size + wire)
+                {
+                    break;
+                }
+
+                const char* payload = inbuf.data() + pos + header_size;
+                pos += header_size + wire;
+
+                if (kind == frame_kind::hello)
+                {
+                    codec = wire != 0 ? options->choose(static_cast<std::uint8_t>(payload[0])) : compression_type::none;
+                }
+                else if (type == compression_type::none)
+                {
+                    f(payload, wire);
+                }
+                else if (outbuf.resize(raw), decompress(type, payload, wire, outbuf.data(), raw))
+                {
+                    f(static_cast<const char*>(outbuf.data()), raw);
+                }
+                else
+                {
+                    ec = asio::error::invalid_argument;
+                    break;
+                }
+            }
+
+            inbuf.erase(0, pos);
+            return ec;
+        }
+
+        /**
+         * @brief Get the codec messages are currently compressed with, `none` until the peer's hello arrived.
+         */
+        compression_type get_codec() const noexcept
+        {
+            return codec;
+        }
+    private:
+        static std::size_t load32(const unsigned char* p) noexcept
+        {
+            return static_cast<std::size_t>(p[0]) | static_cast<std::size_t>(p[1]) << 8 | static_cast<std::size_t>(p[2]) << 16 | static_cast<std::size_t>(p[3]) << 24;
+        }
+
+        static void store32(char* p, std::size_t v) noexcept
+        {
+            p[0] = static_cast<char>(v), p[1] = static_cast<char>(v >> 8), p[2] = static_cast<char>(v >> 16), p[3] = static_cast<char>(v >> 24);
+        }
+
+        static void write_header(char* p, frame_kind kind, compression_type type, std::size_t wire, std::size_t raw) noexcept
+        {
+            store32(p, wire), store32(p + 4, raw);
+            p[8] = static_cast<char>(kind), p[9] = static_cast<char>(type);
+        }
+
+        static void append(std::string& out, frame_kind kind, compression_type type, std::size_t wire, std::size_t raw)
+        {
+            char header[header_size];
+            write_header(header, kind, type, wire, raw);
+            out.append(header, header_size);
+        }
+
+        std::size_t bound(std::size_t n) const noexcept
+        {
+            switch (codec)
+            {
+#if defined(ASIO_EVENT_HAS_LZ4)
+            case compression_type::lz4:
+                return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(n)));
+#endif
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            case compression_type::zstd:
+                return ZSTD_compressBound(n);
+#endif
+            default:
+                return n;
+            }
+        }
+
+        /**
+         * @return Returns the compressed size, `0` on failure.
+         */
+        std::size_t compress([[maybe_unused]] const std::string_view& in, [[maybe_unused]] char* out, [[maybe_unused]] std::size_t cap) noexcept
+        {
+            switch (codec)
+            {
+#if defined(ASIO_EVENT_HAS_LZ4)
+            case compression_type::lz4:
+                return static_cast<std::size_t>(std::max(0, LZ4_compress_fast_extState(lz4_state.get(), in.data(), out, static_cast<int>(in.size()), static_cast<int>(cap), 1)));
+#endif
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            case compression_type::zstd:
+            {
+                std::size_t n = options->zstd_cdict() ? ZSTD_compress_usingCDict(cctx, out, cap, in.data(), in.size(), options->zstd_cdict())
+                                                      : ZSTD_compressCCtx(cctx, out, cap, in.data(), in.size(), options->get_zstd_level());
+                return ZSTD_isError(n) ? 0 : n;
+            }
+#endif
+            default:
+                return 0;
+            }
+        }
+
+        bool decompress(compression_type type, [[maybe_unused]] const char* in, [[maybe_unused]] std::size_t n, [[maybe_unused]] char* out, [[maybe_unused]] std::size_t raw) noexcept
+        {
+            switch (type)
+            {
+#if defined(ASIO_EVENT_HAS_LZ4)
+            case compression_type::lz4:
+                return LZ4_decompress_safe(in, out, static_cast<int>(n), static_cast<int>(raw)) == static_cast<int>(raw);
+#endif
+#if defined(ASIO_EVENT_HAS_ZSTD)
+            case compression_type::zstd:
+                return (options->zstd_ddict() ? ZSTD_decompress_usingDDict(dctx, out, raw, in, n, options->zstd_ddict())
+                                              : ZSTD_decompressDCtx(dctx, out, raw, in, n)) == raw;
+#endif
+            default:
+                return false;
+            }
+        }
+    private:
+        std::shared_ptr<const asio_compression>         options;
+        compression_type                                codec;
+        std::string                                     inbuf;
+        std::string                                     outbuf;
+#if defined(ASIO_EVENT_HAS_LZ4)
+        std::unique_ptr<char[]>                         lz4_state;
+#endif
+#if defined(ASIO_EVENT_HAS_ZSTD)
+        ZSTD_CCtx*                                      cctx;
+        ZSTD_DCtx*                                      dctx;
+#endif
+    };
+}
+
+#endif // __ASIO_COMPRESSION_H__
\ No newline at end of file
@@ -5,9 +5,16 @@
 #	pragma once
 #endif
 
+#include "asio_log.hpp"
+#include "asio_metrics.hpp"
+#include "asio_rate_limit.hpp"
+
 #include <asio.hpp>
 
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace ik
@@ -18,13 +25,34 @@ namespace ik
         explicit asio_context(asio_context* parent = nullptr, size_t id = 0)
             : parent(parent == nullptr ? std::ref(*this) : std::ref(*parent))
             , guard(asio::make_work_guard(*this))
+            , stopped(false)
             , id(id)
+            , limiter(*this)
+        {
+
+        }
+        virtual ~asio_context()
         {
+            stop();
+            limiter.clear();
 
+            // Destroy the handlers still queued while the members they may touch (e.g. the metrics) are alive.
+            asio::execution_context::shutdown();
+            asio::execution_context::destroy();
         }
-        virtual ~asio_context() { stop(); }
     public:
-        void stop() { guard.reset(); };
+        /**
+         * @brief Release the context so its event loop returns once it runs out of work, from any thread.
+         * @note Only the first call releases the guard, the others and the probe just read `stopped`.
+         */
+        void stop()
+        {
+            if (!stopped.exchange(true))
+            {
+                guard.reset();
+            }
+        }
+
         /**
          * @brief Check if the current thread is running the event loop of the `io_context`.
          * @return Returns `true` if the current thread is running the event loop, otherwise `false`.
@@ -36,32 +64,78 @@ namespace ik
 
         /**
          * @brief Dispatch the event loop to run on multiple threads.
-         * @param thrd_size - The number of threads to spawn for running the event loop.
-         * @note If `thrd_size` is greater than 0, the event loop will run on the specified number of threads.
+         * @param task_cnt - The number of threads to spawn for running the event loop, besides the current thread.
+         * @note If `task_cnt` is greater than 0, the event loop will run on the current thread and `task_cnt` more.
          *       Otherwise, the event loop will run on the current thread.
+         *       The spawned threads leave with the loop and are joined before this returns, so a context never runs
+         *       on more threads than configured. A handler throwing does not end the loop of its thread.
          */
         void run(std::size_t task_cnt = 0) noexcept
         {
             try
             {
-                if (task_cnt)
+                // Spawn the specified number of threads to run the event loop.
+                for (std::size_t i = 0; i < task_cnt; ++i)
                 {
-                    // Spawn the specified number of threads to run the event loop.
-                    for (std::size_t i = 0; i < task_cnt; ++i)
-                    {
-                        thread.emplace_back([=] () mutable {
-                            asio::io_context::run();
-                        }).detach();
-                    }
+                    thread.emplace_back([this] {
+                        current_ref() = this;
+                        run_loop();
+                    });
                 }
-
-                // Run the event loop on the current thread.
-                asio::io_context::run();
             }
-            catch (const std::exception&)
+            catch (const std::exception& ex)
             {
+                ASIO_LOG_ERROR("%s", ex.what());
+            }
+
+            // Run the event loop on the current thread.
+            asio_context* previous = std::exchange(current_ref(), this);
+            run_loop();
+            current_ref() = previous;
 
+            for (std::jthread& worker : thread)
+            {
+                worker.join();
             }
+
+            thread.clear();
+        }
+
+        /**
+         * @brief Get the context whose event loop the calling thread is running.
+         * @return Returns the context, or `nullptr` if the thread is not inside `run`.
+         * @note Used to attribute handler timings to the right context without passing it around.
+         */
+        static asio_context* current() noexcept
+        {
+            return current_ref();
+        }
+
+        /**
+         * @brief Start measuring the loop lag of this context.
+         * @param interval - How often a probe is posted.
+         * @note Every `interval` a handler is posted to the back of the queue and the time until it runs is recorded
+         *       in `get_metrics().lag()`. The probe ends once `stop()` released the context.
+         */
+        void probe(const std::chrono::milliseconds& interval = std::chrono::milliseconds(100))
+        {
+            asio::co_spawn(*this, [this, interval] () -> asio::awaitable<void>
+            {
+                asio::error_code ec;
+                asio::steady_timer timer(*this);
+
+                for (timer.expires_after(interval); !stopped.load(std::memory_order_acquire); timer.expires_after(interval))
+                {
+                    if (co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec)), ec)
+                    {
+                        co_return;
+                    }
+
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    co_await asio::post(*this, asio::use_awaitable);
+                    metrics.lag().record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+                }
+            }, asio::detached);
         }
 
         /**
@@ -81,11 +155,63 @@ namespace ik
         {
             return std::ref(parent);
         };
+
+        /**
+         * @brief Get the counters of the sessions, accepts and connects running on this context.
+         * @return Returns a reference to the `asio_metrics` of this context.
+         */
+        asio_metrics& get_metrics() noexcept
+        {
+            return metrics;
+        }
+
+        const asio_metrics& get_metrics() const noexcept
+        {
+            return metrics;
+        }
+
+        /**
+         * @brief Get the rate budget shared by the sessions of this context, and the clock pausing them.
+         * @return Returns a reference to the `asio_rate_limiter` of this context.
+         */
+        asio_rate_limiter& get_limiter() noexcept
+        {
+            return limiter;
+        }
     private:
         asio_context&                                              parent;
         asio::executor_work_guard<asio::io_context::executor_type> guard;
+        std::atomic_bool                                           stopped;
         std::atomic_size_t                                         id;
         std::vector<std::jthread>                                  thread;
+        asio_metrics                                               metrics;
+        asio_rate_limiter                                          limiter;
+    private:
+        /**
+         * @brief Run the event loop on the calling thread until it stops or runs out of work.
+         */
+        void run_loop() noexcept
+        {
+            for (;;)
+            {
+                try
+                {
+                    asio::io_context::run();
+                    return;
+                }
+                catch (const std::exception& ex)
+                {
+                    // An exception escaping a handler leaves the loop, which can be run again right away.
+                    ASIO_LOG_ERROR("%s", ex.what());
+                }
+            }
+        }
+
+        static asio_context*& current_ref() noexcept
+        {
+            thread_local asio_context* context = nullptr;
+            return context;
+        }
     };
 }
 
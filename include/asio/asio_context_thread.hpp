@@ -6,11 +6,15 @@
 #endif
 
 #include "asio_context.hpp"
+#include "asio_log.hpp"
 
 #include <asio.hpp>
 #include <atomic>
-#include <semaphore>
+#include <functional>
+#include <latch>
 #include <memory>
+#include <stop_token>
+#include <thread>
 
 namespace ik
 {
@@ -24,44 +28,100 @@ namespace ik
             , task_num(task_num)
             , task_max(task_max)
             , task_tick(0)
-            , semaphore(0)
+            , task_drain(false)
         {
         }
-        virtual ~asio_context_thread() = default;
+        virtual ~asio_context_thread()
+        {
+            // Join before the context goes away, the worker is still running on it.
+            stop(), join();
+        }
     private:
         asio_context_thread& operator=(const asio_context_thread&) = delete;
     public:
         /**
-         * @brief Initialize the worker thread and semaphore.
-         * @return Returns `true` if initialization is successful within 3 seconds, otherwise `false`.
-         * @note This function creates a worker thread if it doesn't already exist and attempts to acquire the semaphore within a timeout.
+         * @brief Start the worker thread and wait until its context is ready.
+         * @return Returns `true` if the context was created, otherwise `false`.
+         * @note To start several workers in parallel, `start` them with a shared latch and wait on it once.
          */
         bool init()
         {
-            if (worker == nullptr)
+            std::shared_ptr<std::latch> ready = std::make_shared<std::latch>(1);
+
+            if (!start(ready))
             {
-                worker = std::make_unique<std::jthread>(std::bind(&asio_context_thread::dispatch, this, std::placeholders::_1));
+                return io_thread_context != nullptr;
             }
 
-            return semaphore.try_acquire_for(std::chrono::seconds(3));
+            return ready->wait(), io_thread_context != nullptr;
         }
 
         /**
-         * @brief Stop the worker thread.
+         * @brief Start the worker thread without waiting for it.
+         * @param ready - A latch counted down once when the worker's context is ready, or failed to be created.
+         * @param started - Called on the worker thread right after the latch, e.g. to hand the context over without
+         *        anyone waiting on the latch.
+         * @return Returns `true` if a worker was started, `false` if it already runs and the latch is left untouched.
+         */
+        bool start(std::shared_ptr<std::latch> ready, std::function<void()> started = nullptr)
+        {
+            if (worker != nullptr)
+            {
+                return false;
+            }
+
+            worker = std::make_unique<std::jthread>([this, ready = std::move(ready), started = std::move(started)] (std::stop_token stop_token) {
+                dispatch(stop_token, *ready, started);
+            });
+
+            return true;
+        }
+
+        /**
+         * @brief Stop the event loop and its threads, handlers still queued are dropped.
          * @return Returns `true` if the worker thread is successfully requested to stop, otherwise `false`.
-         * @note This function checks if the worker thread is joinable and requests it to stop.
+         * @note The threads leave their current handler and return, call `join` to wait for them.
          */
         bool stop()
         {
-            if (worker->joinable())
+            return worker != nullptr && worker->request_stop();
+        }
+
+        /**
+         * @brief Wait for the worker thread and the threads of its context to return.
+         * @note Does nothing when called on the worker thread itself, the thread is then left to finish on its own.
+         */
+        void join()
+        {
+            if (worker == nullptr || !worker->joinable())
             {
-                if (worker->request_stop())
-                {
-                    return true;
-                }
+                return;
             }
 
-            return false;
+            if (worker->get_id() == std::this_thread::get_id())
+            {
+                worker->detach();
+                return;
+            }
+
+            worker->join();
+        }
+
+        /**
+         * @brief Let the event loop run out once the context holds no more sessions, which ends the worker thread.
+         * @return Returns `true` if the context was released, the thread is joined when this object is destroyed.
+         * @note Unlike `stop`, handlers still queued on the context run first, a pending timer (e.g. the lag probe)
+         *       lets it return within one period.
+         */
+        bool retire()
+        {
+            if (io_thread_context == nullptr)
+            {
+                return false;
+            }
+
+            io_thread_context->stop();
+            return true;
         }
 
         /**
@@ -86,25 +146,42 @@ namespace ik
 
         /**
          * @brief Dispatch the event loop on the worker thread.
-         * @param stop_token - A stop token to check for stop requests.
-         * @note This function initializes the `io_thread_context` if it doesn't exist and runs the event loop until a stop is requested.
+         * @param stop_token - A stop token, a stop request stops the event loop.
+         * @param ready - A latch counted down once the context exists, or failed to be created.
+         * @param started - Called after the latch, before the event loop runs.
+         * @note This function creates the `io_thread_context` and runs its event loop on this thread and `task_cnt`
+         *       more, until it is stopped or released by `retire`. The event loop runs once, so the thread count stays
+         *       as configured.
          */
-        void dispatch(const std::stop_token& stop_token)
+        void dispatch(const std::stop_token& stop_token, std::latch& ready, const std::function<void()>& started = nullptr)
         {
-            if (io_thread_context == nullptr)
+            try
             {
                 io_thread_context = std::make_unique<asio_context>(std::addressof(io_context), task_idx.load());
+                io_thread_context->probe();
+            }
+            catch (const std::exception& ex)
+            {
+                ASIO_LOG_ERROR("%s", ex.what());
             }
 
-            if (io_thread_context == nullptr)
+            ready.count_down();
+
+            if (started)
             {
-                return;
+                started();
             }
 
-            while (!stop_token.stop_requested())
+            if (io_thread_context == nullptr)
             {
-                semaphore.release(), io_thread_context->run(task_cnt.load());
+                return;
             }
+
+            std::stop_callback callback(stop_token, [this] {
+                io_thread_context->stop(), io_thread_context->asio::io_context::stop();
+            });
+
+            io_thread_context->run(task_cnt.load());
         }
     public:
         asio_context&                                                       io_context;
@@ -113,7 +190,7 @@ namespace ik
         std::atomic_size_t                                                  task_num;                    // 当前任务
         std::atomic_size_t                                                  task_max;                    // 最大任务
         std::atomic_ullong                                                  task_tick;                   // 累计使用
-        std::binary_semaphore                                               semaphore;
+        std::atomic_bool                                                    task_drain;                  // 正在排空
         std::unique_ptr<std::jthread>                                       worker;
         std::unique_ptr<asio_context>                                       io_thread_context;
     };
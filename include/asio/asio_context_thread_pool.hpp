@@ -7,26 +7,57 @@
 
 #include "asio_context.hpp"
 #include "asio_context_thread.hpp"
+#include "asio_log.hpp"
 
 #include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <latch>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <ranges>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace ik
 {
+    /**
+     * @brief When an autoscaling pool adds and retires contexts, see `asio_context_thread_pool::autoscale`.
+     * @note The utilization of a context is the share of its threads' time spent in binder handlers over the last
+     *       interval, and the lag the mean time a posted handler waited before it ran.
+     */
+    struct asio_pool_scaling
+    {
+        std::size_t                                     min_contexts = 1;
+        std::size_t                                     max_contexts = std::max(1u, std::thread::hardware_concurrency());
+        std::chrono::milliseconds                       interval{ 1000 };
+        double                                          grow_utilization = 0.75;                    // mean over the contexts
+        std::chrono::microseconds                       grow_lag{ 2000 };                           // worst context
+        double                                          shrink_utilization = 0.25;
+        std::size_t                                     shrink_after = 5;                           // quiet intervals in a row
+    };
+
     class asio_context_thread_pool
     {
     public:
         explicit asio_context_thread_pool(asio_context& io_context)
             : io_context(io_context)
+            , task_cnt(0)
+            , next_idx(0)
+            , watch_key(0)
         {
 
         }
 
         virtual ~asio_context_thread_pool()
         {
-
+            if (scaling)
+            {
+                scaling->active.store(false);
+            }
         }
     public:
         /**
@@ -35,35 +66,112 @@ namespace ik
          * @param thr_child - The number of child threads per root thread.
          * @note This function creates `thr_root` root threads, each managing `thr_child` child threads.
          *       Each root thread is associated with an `asio_event_thread` instance.
+         *       The root threads start in parallel, it returns once all of their contexts are ready.
          */
         void init(std::size_t ctx_cnt, std::size_t thrd_cnt = 0)
         {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            std::shared_ptr<std::latch> ready = std::make_shared<std::latch>(static_cast<std::ptrdiff_t>(ctx_cnt));
+
             for (std::size_t i = 0; i < ctx_cnt; ++i)
             {
                 io_context_thread.emplace(io_context_thread.begin() + i, std::make_shared<asio_context_thread>(io_context, thrd_cnt, i, 0, 1024));
+
+                if (!io_context_thread[i]->start(ready))
+                {
+                    ready->count_down();
+                }
             }
 
-            for (const auto& context : io_context_thread)
+            ready->wait();
+
+            for (std::size_t i = 0; i < ctx_cnt; ++i)
             {
-                if (context->init())
+                if (io_context_thread[i]->io_thread_context == nullptr)
                 {
-                    continue;
+                    ASIO_LOG_ERROR("context pool: context %zu failed to start", i);
                 }
             }
+
+            task_cnt = thrd_cnt, next_idx = io_context_thread.size();
         }
 
         /**
-         * @brief Stop all root threads and their associated child threads.
-         * @note This function stops each root thread by calling its `stop` method.
+         * @brief Grow and shrink the pool with its load, checked every `policy.interval` on the parent context.
+         * @param policy - The bounds and thresholds.
+         * @note A context is added when the contexts are busy or one of them lags. New connections then go to it,
+         *       as `get_context_idx` prefers the context with the fewest live sessions. After `shrink_after` quiet intervals
+         *       the context with the fewest sessions stops taking new ones, and it is retired once its last session
+         *       is gone. A retired context's thread is stopped, the object is kept until the pool is destroyed so
+         *       references to it stay valid, but work posted to it afterwards never runs: `get_context` maps its index
+         *       to a live context, and `watch` tells the executors spreading work over the pool to leave it first.
+         *       A new context's thread is started without blocking the parent context, and takes sessions once it runs.
+         *       Call after `init`, the parent context must be running.
+         */
+        void autoscale(const asio_pool_scaling& policy)
+        {
+            if (scaling)
+            {
+                scaling->active.store(false);
+            }
+
+            scaling = std::make_shared<scaling_state>(policy);
+
+            asio::co_spawn(io_context, [this, state = scaling] () -> asio::awaitable<void>
+            {
+                asio::error_code ec;
+                asio::steady_timer timer(io_context);
+
+                for (timer.expires_after(state->policy.interval); state->active.load(); timer.expires_after(state->policy.interval))
+                {
+                    if (co_await timer.async_wait(asio::redirect_error(asio::use_awaitable, ec)), ec || !state->active.load())
+                    {
+                        co_return;
+                    }
+
+                    try
+                    {
+                        rebalance(state);
+                    }
+                    catch (const std::exception& ex)
+                    {
+                        ASIO_LOG_ERROR("%s", ex.what());
+                    }
+                }
+            }, asio::detached);
+        }
+
+        /**
+         * @brief Stop all root threads and their associated child threads, and wait for them.
+         * @note This function stops each root thread by calling its `stop` method, then joins them all, so the
+         *       contexts stop in parallel. Contexts retired by autoscaling are joined too.
          */
         void stop()
         {
-            for (const auto& context : io_context_thread)
+            std::vector<std::shared_ptr<asio_context_thread>> contexts;
+
             {
-                if (context->stop())
+                std::shared_lock<std::shared_mutex> lock(mutex);
+
+                if (scaling)
                 {
-                    continue;
+                    scaling->active.store(false);
                 }
+
+                contexts.insert(contexts.end(), io_context_thread.begin(), io_context_thread.end());
+                contexts.insert(contexts.end(), io_context_retired.begin(), io_context_retired.end());
+                contexts.insert(contexts.end(), io_context_starting.begin(), io_context_starting.end());
+            }
+
+            for (const auto& context : contexts)
+            {
+                context->stop();
+            }
+
+            // Joined without the lock, a context's threads may still look up the pool while they finish.
+            for (const auto& context : contexts)
+            {
+                context->join();
             }
         }
 
@@ -83,30 +191,55 @@ namespace ik
          * @return Returns a reference to the selected `asio_event` context.
          * @note If the index has the highest bit set, it returns the global `io_context`.
          *       Otherwise, it returns the context from the corresponding root thread.
+         *       Indexes stay with their context when an autoscaling pool adds contexts. The index of a retired
+         *       context maps to a live one, as a retired context no longer runs what is posted to it.
          */
         asio_context& get_context(std::size_t n)
         {
-            return ((n & (static_cast<std::size_t>(1) << (sizeof(std::uint32_t) * 8 - 1))) != 0) ? io_context : io_context_thread[n % io_context_thread.size()]->get_context();
+            if ((n & (static_cast<std::size_t>(1) << (sizeof(std::uint32_t) * 8 - 1))) != 0)
+            {
+                return io_context;
+            }
+
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            if (n < io_context_thread.size() && io_context_thread[n]->task_idx.load() == n)
+            {
+                return io_context_thread[n]->get_context();
+            }
+
+            for (const auto& context : io_context_thread)
+            {
+                if (context->task_idx.load() == n)
+                {
+                    return context->get_context();
+                }
+            }
+
+            return io_context_thread[n % io_context_thread.size()]->get_context();
         }
 
         /**
          * @brief Get the index of the most suitable IO context.
-         * @return Returns the index of the context with the least number of active tasks.
-         * @note This function filters root threads that have not reached their maximum task capacity
-         *       and selects the one with the least number of active tasks.
-         *       If no valid context is found, it returns the maximum value of `std::int32_t`.
+         * @return Returns the index of the context with the fewest live sessions.
+         * @note This function filters root threads that hold fewer than `task_max` sessions and are not being drained,
+         *       and selects the one with the fewest, read from the `metric_type::sessions` gauge of its context.
+         *       Ties go to the context picked least often, so a burst of connections is spread before the gauges
+         *       count them. If no valid context is found, it returns the maximum value of `std::int32_t` plus one.
          */
         std::size_t get_context_idx()
         {
-            // Filter root threads that have not reached their maximum task capacity.
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            // Filter root threads that have not reached their maximum task capacity, nor are being drained.
             auto valid_view = io_context_thread | std::views::filter([] (const std::shared_ptr<asio_context_thread>& task) {
-                return task->task_num.load() < task->task_max.load();
+                return sessions(*task) < task->task_max.load() && !task->task_drain.load();
             });
 
             // If no valid context is found, return the maximum value of `std::int32_t`.
             if (valid_view.empty())
             {
-                return std::numeric_limits<std::int32_t>::max() + 1;
+                return static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()) + 1;
             }
 
             // Create a vector of valid root threads.
@@ -115,17 +248,347 @@ namespace ik
                 valid_view.begin(), valid_view.end()
             };
 
-            // Select the root thread with the least number of active tasks.
+            // Select the root thread with the fewest live sessions.
             return std::ranges::min(valid_tasks,
                                     {},
                                     [] (const std::shared_ptr<asio_context_thread>& task)
             {
-                return task->task_num.load();
+                return std::make_pair(sessions(*task), task->task_tick.load());
             }).get()->get_idx();
         }
+
+        /**
+         * @brief Get the indexes of the contexts taking new sessions, i.e. not being drained, in the pool's order.
+         */
+        std::vector<std::size_t> get_context_indices() const
+        {
+            std::vector<std::size_t> indices;
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            for (const auto& context : io_context_thread)
+            {
+                if (!context->task_drain.load())
+                {
+                    indices.emplace_back(context->task_idx.load());
+                }
+            }
+
+            return indices;
+        }
+
+        /**
+         * @brief Follow the contexts of the pool as an autoscaling pool adds and retires them.
+         * @param handler - Called with `true` for every context in the pool now and for each one added later, and with
+         *        `false` just before a context is retired, after which work posted to it never runs. It runs on the
+         *        thread changing the pool, for autoscaling a thread of the parent context.
+         * @return Returns the key to pass to `unwatch`.
+         * @note A context may be reported as added twice when it is added while `watch` runs.
+         */
+        std::size_t watch(std::function<void(asio_context&, bool)> handler)
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            std::vector<std::shared_ptr<asio_context_thread>> contexts;
+
+            {
+                std::shared_lock<std::shared_mutex> shared(mutex);
+                contexts = io_context_thread;
+            }
+
+            for (const auto& context : contexts)
+            {
+                handler(context->get_context(), true);
+            }
+
+            watchers.emplace(++watch_key, std::move(handler));
+            return watch_key;
+        }
+
+        /**
+         * @brief Stop calling a handler added by `watch`, it is not running anymore when this returns.
+         */
+        void unwatch(std::size_t key)
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            watchers.erase(key);
+        }
+
+        /**
+         * @brief Get the number of contexts in the pool, not counting the parent context.
+         */
+        std::size_t size() const noexcept
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            return io_context_thread.size();
+        }
+
+        /**
+         * @brief Aggregate the counters of the parent context and every context of the pool.
+         * @return Returns the summed counters and merged error counts.
+         * @note The counters are read with relaxed loads while the contexts keep running, so the result is a close
+         *       but not exact point in time. Contexts retired by autoscaling still count.
+         */
+        asio_metrics_snapshot snapshot()
+        {
+            asio_metrics_snapshot result = io_context.get_metrics().snapshot();
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            for (const auto& contexts : { std::cref(io_context_thread), std::cref(io_context_retired) })
+            {
+                for (const auto& context : contexts.get())
+                {
+                    if (context->io_thread_context)
+                    {
+                        result += context->io_thread_context->get_metrics().snapshot();
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Get the counters of a single context.
+         * @param n - The index of the context, with the same meaning as for `get_context(std::size_t)`.
+         * @return Returns the counters of the selected context.
+         */
+        asio_metrics_snapshot snapshot(std::size_t n)
+        {
+            return get_context(n).get_metrics().snapshot();
+        }
+    private:
+        /**
+         * @brief Read the live session gauge of a context, which is what autoscaling retires it by too.
+         */
+        static std::size_t sessions(asio_context_thread& context)
+        {
+            return static_cast<std::size_t>(std::max<std::int64_t>(context.get_context().get_metrics().get(metric_type::sessions), 0));
+        }
+
+        /**
+         * @brief Counters of a context at the previous check, to measure the last interval.
+         */
+        struct scaling_sample
+        {
+            double                                      handler = 0;                                // nanoseconds in handlers
+            double                                      lag = 0;                                    // nanoseconds of lag, summed
+            std::uint64_t                               probes = 0;
+            std::size_t                                 drained = 0;                                // checks since draining started
+        };
+
+        struct scaling_state
+        {
+            explicit scaling_state(const asio_pool_scaling& policy)
+                : policy(policy)
+                , active(true)
+                , quiet(0)
+            {
+            }
+
+            asio_pool_scaling                           policy;
+            std::atomic_bool                            active;
+            std::size_t                                 quiet;
+            std::unordered_map<std::size_t, scaling_sample> samples;
+        };
+
+        /**
+         * @brief Measure the last interval of every context, then add, drain or retire one context as the policy says.
+         * @note A draining context is retired on a later check than the one that drained it, so a connection handed
+         *       to it just before is not cut off. No context is added while one is still starting.
+         */
+        void rebalance(const std::shared_ptr<scaling_state>& shared)
+        {
+            scaling_state& state = *shared;
+            std::vector<std::shared_ptr<asio_context_thread>> contexts;
+            std::vector<std::shared_ptr<asio_context_thread>> idle;
+            std::shared_ptr<asio_context_thread> quietest, drained;
+            double busy = 0, lag = 0, period = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(state.policy.interval).count());
+            std::size_t active = 0;
+            bool starting = false;
+
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                contexts = io_context_thread, starting = !io_context_starting.empty();
+            }
+
+            for (const auto& context : contexts)
+            {
+                asio_metrics& metrics = context->get_context().get_metrics();
+                scaling_sample& sample = state.samples[context->task_idx.load()];
+                scaling_sample current;
+                std::int64_t sessions = metrics.snapshot()[metric_type::sessions];
+
+                for (std::size_t i = 0; i < asio_metrics::handler_cnt; ++i)
+                {
+                    current.handler += metrics.handler(i).mean() * static_cast<double>(metrics.handler(i).count());
+                }
+
+                current.lag = metrics.lag().mean() * static_cast<double>(metrics.lag().count());
+                current.probes = metrics.lag().count();
+                current.drained = context->task_drain.load() ? sample.drained + 1 : 0;
+
+                if (context->task_drain.load())
+                {
+                    if (sessions <= 0 && sample.drained != 0)
+                    {
+                        idle.emplace_back(context);
+                    }
+                    else if (!drained || sessions > drained->get_context().get_metrics().snapshot()[metric_type::sessions])
+                    {
+                        drained = context;
+                    }
+                }
+                else
+                {
+                    busy += (current.handler - sample.handler) / (period * static_cast<double>(context->task_cnt.load() + 1));
+                    lag = std::max(lag, current.probes > sample.probes ? (current.lag - sample.lag) / static_cast<double>(current.probes - sample.probes) : 0.0);
+                    active++;
+
+                    if (!quietest || sessions < quietest->get_context().get_metrics().snapshot()[metric_type::sessions])
+                    {
+                        quietest = context;
+                    }
+                }
+
+                sample = current;
+            }
+
+            double utilization = active ? busy / static_cast<double>(active) : 0;
+            double threshold = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(state.policy.grow_lag).count());
+
+            if ((utilization >= state.policy.grow_utilization || lag >= threshold) && active < state.policy.max_contexts && !starting)
+            {
+                ASIO_LOG_INFO("context pool: grow to %zu contexts (utilization %.2f, lag %.0fus)", active + 1, utilization, lag / 1000);
+                state.quiet = 0;
+
+                // Take back a context being drained before starting a new thread.
+                if (drained)
+                {
+                    drained->task_drain.store(false);
+                }
+                else
+                {
+                    grow(shared);
+                }
+            }
+            else if (utilization <= state.policy.shrink_utilization && lag < threshold / 4 && active > std::max<std::size_t>(state.policy.min_contexts, 1))
+            {
+                if (++state.quiet >= state.policy.shrink_after && quietest)
+                {
+                    ASIO_LOG_INFO("context pool: drain context %zu (utilization %.2f)", quietest->task_idx.load(), utilization);
+                    state.quiet = 0;
+                    quietest->task_drain.store(true);
+                }
+            }
+            else
+            {
+                state.quiet = 0;
+            }
+
+            for (const auto& context : idle)
+            {
+                retire(context);
+                state.samples.erase(context->task_idx.load());
+            }
+        }
+
+        /**
+         * @brief Start a new context without waiting for its thread, `admit` adds it to the pool once it runs.
+         */
+        void grow(const std::shared_ptr<scaling_state>& state)
+        {
+            std::shared_ptr<asio_context_thread> context = std::make_shared<asio_context_thread>(io_context, task_cnt, next_idx.fetch_add(1), 0, 1024);
+
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                io_context_starting.emplace_back(context);
+            }
+
+            // Back on the parent context, unless autoscaling stopped meanwhile, the pool then joins the thread.
+            context->start(std::make_shared<std::latch>(1), [this, state, weak = std::weak_ptr<asio_context_thread>(context)] {
+                asio::post(io_context, [this, state, weak] {
+                    if (std::shared_ptr<asio_context_thread> started = weak.lock(); started && state->active.load())
+                    {
+                        admit(started);
+                    }
+                });
+            });
+        }
+
+        /**
+         * @brief Make a started context available to `get_context_idx`, and tell the watchers.
+         */
+        void admit(const std::shared_ptr<asio_context_thread>& context)
+        {
+            bool ready = context->io_thread_context != nullptr;
+
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+
+                if (std::erase(io_context_starting, context) == 0)
+                {
+                    return;
+                }
+
+                if (ready)
+                {
+                    io_context_thread.emplace_back(context);
+                }
+            }
+
+            if (!ready)
+            {
+                ASIO_LOG_ERROR("context pool: context %zu failed to start", context->task_idx.load());
+                return;
+            }
+
+            notify(context->get_context(), true);
+        }
+
+        /**
+         * @brief Remove a drained context from the pool and stop its thread, once the watchers have left it.
+         */
+        void retire(const std::shared_ptr<asio_context_thread>& context)
+        {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+
+                if (std::erase(io_context_thread, context) == 0)
+                {
+                    return;
+                }
+
+                io_context_retired.emplace_back(context);
+            }
+
+            ASIO_LOG_INFO("context pool: retire context %zu", context->task_idx.load());
+            notify(context->get_context(), false);
+            context->retire();
+        }
+
+        /**
+         * @brief Call the handlers added by `watch`.
+         */
+        void notify(asio_context& context, bool joined)
+        {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+
+            for (const auto& [key, handler] : watchers)
+            {
+                handler(context, joined);
+            }
+        }
     private:
         asio_context&                                                       io_context;
         std::vector<std::shared_ptr<asio_context_thread>>                     io_context_thread;
+        std::vector<std::shared_ptr<asio_context_thread>>                     io_context_retired;
+        std::vector<std::shared_ptr<asio_context_thread>>                     io_context_starting;
+        mutable std::shared_mutex                                             mutex;
+        std::size_t                                                           task_cnt;
+        std::atomic_size_t                                                    next_idx;
+        std::shared_ptr<scaling_state>                                        scaling;
+        std::mutex                                                            watch_mutex;
+        std::size_t                                                           watch_key;
+        std::unordered_map<std::size_t, std::function<void(asio_context&, bool)>> watchers;
     };
 }
 
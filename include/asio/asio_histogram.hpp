@@ -0,0 +1,179 @@
+﻿#ifndef __ASIO_HISTOGRAM_H__
+#define __ASIO_HISTOGRAM_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace ik
+{
+    /**
+     * @brief Log-linear (HDR style) histogram of unsigned 64-bit values.
+     * @note Every power of two is split into `1 << sub_bits` linear sub-buckets, which bounds the relative error of
+     *       a reported percentile to about 3% over the full 64-bit range. Recording is a relaxed atomic increment,
+     *       so one histogram may be shared by several threads; readers see an approximate but consistent-enough view.
+     */
+    class asio_histogram
+    {
+    public:
+        static constexpr std::size_t sub_bits = 5;
+        static constexpr std::size_t sub_cnt = static_cast<std::size_t>(1) << sub_bits;
+        static constexpr std::size_t bucket_cnt = (64 - sub_bits + 1) * sub_cnt;
+    public:
+        asio_histogram() noexcept
+        {
+            reset();
+        }
+        virtual ~asio_histogram() = default;
+    private:
+        asio_histogram(const asio_histogram&) = delete;
+        asio_histogram& operator=(const asio_histogram&) = delete;
+    public:
+        /**
+         * @brief Record one value.
+         * @param value - The value to record (e.g. a latency in nanoseconds).
+         */
+        void record(std::uint64_t value) noexcept
+        {
+            buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(value, std::memory_order_relaxed);
+
+            for (std::uint64_t cur = lowest.load(std::memory_order_relaxed); value < cur && !lowest.compare_exchange_weak(cur, value, std::memory_order_relaxed); );
+            for (std::uint64_t cur = highest.load(std::memory_order_relaxed); value > cur && !highest.compare_exchange_weak(cur, value, std::memory_order_relaxed); );
+        }
+
+        /**
+         * @brief Add every value recorded in another histogram to this one.
+         * @param other - The histogram to merge from.
+         */
+        void merge(const asio_histogram& other) noexcept
+        {
+            for (std::size_t i = 0; i < bucket_cnt; ++i)
+            {
+                if (std::uint64_t n = other.buckets[i].load(std::memory_order_relaxed); n != 0)
+                {
+                    buckets[i].fetch_add(n, std::memory_order_relaxed);
+                }
+            }
+
+            total.fetch_add(other.total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            for (std::uint64_t value = other.lowest.load(std::memory_order_relaxed), cur = lowest.load(std::memory_order_relaxed); value < cur && !lowest.compare_exchange_weak(cur, value, std::memory_order_relaxed); );
+            for (std::uint64_t value = other.highest.load(std::memory_order_relaxed), cur = highest.load(std::memory_order_relaxed); value > cur && !highest.compare_exchange_weak(cur, value, std::memory_order_relaxed); );
+        }
+
+        /**
+         * @brief Clear every recorded value.
+         * @note Not atomic with respect to concurrent `record` calls.
+         */
+        void reset() noexcept
+        {
+            for (auto& bucket : buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+
+            total.store(0, std::memory_order_relaxed);
+            sum.store(0, std::memory_order_relaxed);
+            lowest.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+            highest.store(0, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the value below which a fraction `q` of the recorded values fall.
+         * @param q - The quantile in `[0, 1]`, e.g. `0.999` for p99.9.
+         * @return Returns the highest value equivalent to the bucket holding the quantile, or 0 if nothing was recorded.
+         */
+        std::uint64_t percentile(double q) const noexcept
+        {
+            std::uint64_t n = total.load(std::memory_order_relaxed);
+
+            if (n == 0)
+            {
+                return 0;
+            }
+
+            std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(n) + 0.5);
+            std::uint64_t seen = 0;
+
+            rank = rank == 0 ? 1 : (rank > n ? n : rank);
+
+            for (std::size_t i = 0; i < bucket_cnt; ++i)
+            {
+                if ((seen += buckets[i].load(std::memory_order_relaxed)) >= rank)
+                {
+                    std::uint64_t value = upper(i);
+                    return value > max() ? max() : value;
+                }
+            }
+
+            return max();
+        }
+
+        std::uint64_t count() const noexcept
+        {
+            return total.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t min() const noexcept
+        {
+            return count() ? lowest.load(std::memory_order_relaxed) : 0;
+        }
+
+        std::uint64_t max() const noexcept
+        {
+            return highest.load(std::memory_order_relaxed);
+        }
+
+        double mean() const noexcept
+        {
+            std::uint64_t n = count();
+            return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+        }
+    private:
+        /**
+         * @brief Map a value to its bucket.
+         */
+        static constexpr std::size_t index(std::uint64_t value) noexcept
+        {
+            if (value < sub_cnt)
+            {
+                return static_cast<std::size_t>(value);
+            }
+
+            std::size_t shift = static_cast<std::size_t>(std::bit_width(value)) - 1 - sub_bits;
+            return (shift + 1) * sub_cnt + static_cast<std::size_t>((value >> shift) - sub_cnt);
+        }
+
+        /**
+         * @brief Get the highest value that maps to a bucket.
+         */
+        static constexpr std::uint64_t upper(std::size_t i) noexcept
+        {
+            if (i < sub_cnt)
+            {
+                return i;
+            }
+
+            std::size_t shift = i / sub_cnt - 1;
+            std::uint64_t sub = static_cast<std::uint64_t>(i % sub_cnt + sub_cnt);
+            return ((sub + 1) << shift) - 1;
+        }
+    private:
+        std::array<std::atomic_uint64_t, bucket_cnt>                           buckets;
+        std::atomic_uint64_t                                                   total;
+        std::atomic_uint64_t                                                   sum;
+        std::atomic_uint64_t                                                   lowest;
+        std::atomic_uint64_t                                                   highest;
+    };
+}
+
+#endif // __ASIO_HISTOGRAM_H__
\ No newline at end of file
@@ -0,0 +1,629 @@
+﻿#ifndef __ASIO_LOG_H__
+#define __ASIO_LOG_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace ik
+{
+    enum class log_level : std::uint8_t
+    {
+        trace,
+        debug,
+        info,
+        warn,
+        error,
+        off
+    };
+
+    /**
+     * @brief One log call, with its arguments still in binary form.
+     * @note The format string is not copied and must outlive the logger, which string literals do. Text arguments are
+     *       copied and truncated if they do not fit.
+     */
+    struct asio_log_record
+    {
+        static constexpr std::size_t args_size = 208;
+
+        std::int64_t                                    ts;                                         // system clock, nanoseconds
+        const char*                                     fmt;
+        void                                            (*format)(std::string& out, const char* fmt, const unsigned char* args);
+        std::uint64_t                                   suppressed;
+        std::uint32_t                                   tid;
+        log_level                                       level;
+        unsigned char                                   args[args_size];
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        inline constexpr bool is_log_text_v = std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*> ||
+                                              std::is_same_v<std::decay_t<T>, std::string> || std::is_same_v<std::decay_t<T>, std::string_view>;
+
+        /**
+         * @brief The type an argument is stored and formatted as, text becomes `const char*` into the record.
+         */
+        template <typename T>
+        using log_arg_t = std::conditional_t<is_log_text_v<T>, const char*, std::decay_t<T>>;
+
+        template <typename T>
+        inline constexpr std::size_t log_value_size_v = is_log_text_v<T> ? 0 : sizeof(log_arg_t<T>);
+
+        /**
+         * @brief Values are stored first, in order, then every text as a 16-bit length and its null-terminated bytes.
+         */
+        template <typename... Types>
+        struct log_codec
+        {
+            static constexpr std::size_t values_size = (std::size_t{ 0 } + ... + log_value_size_v<Types>);
+            static constexpr std::size_t text_cnt = (std::size_t{ 0 } + ... + (is_log_text_v<Types> ? 1 : 0));
+
+            static_assert((std::is_trivially_copyable_v<log_arg_t<Types>> && ...), "log arguments must be text or trivially copyable");
+            static_assert(values_size + text_cnt * 3 <= asio_log_record::args_size, "too many log arguments");
+
+            static void encode(unsigned char* buf, const Types&... args) noexcept
+            {
+                [[maybe_unused]] unsigned char* p = buf;
+                (encode_value(p, args), ...);
+
+                [[maybe_unused]] std::size_t left = text_cnt;
+                (encode_text(p, buf + asio_log_record::args_size, left, args), ...);
+            }
+
+            static void format(std::string& out, const char* fmt, const unsigned char* buf)
+            {
+                [[maybe_unused]] const unsigned char* vp = buf;
+                [[maybe_unused]] const unsigned char* tp = buf + values_size;
+                std::tuple<log_arg_t<Types>...> values{ decode<Types>(vp, tp)... };
+
+                std::apply([&] (const auto&... items) {
+                    char line[1024];
+                    int n = 0;
+
+                    if constexpr (sizeof...(items) == 0)
+                    {
+                        n = std::snprintf(line, sizeof(line), "%s", fmt);
+                    }
+                    else
+                    {
+                        n = std::snprintf(line, sizeof(line), fmt, items...);
+                    }
+
+                    out.append(line, n < 0 ? 0 : (static_cast<std::size_t>(n) < sizeof(line) ? static_cast<std::size_t>(n) : sizeof(line) - 1));
+                }, values);
+            }
+        private:
+            template <typename T>
+            static void encode_value(unsigned char*& p, const T& val) noexcept
+            {
+                if constexpr (!is_log_text_v<T>)
+                {
+                    log_arg_t<T> item = val;
+                    std::memcpy(p, &item, sizeof(item));
+                    p += sizeof(item);
+                }
+            }
+
+            template <typename T>
+            static void encode_text(unsigned char*& p, unsigned char* end, std::size_t& left, const T& val) noexcept
+            {
+                if constexpr (is_log_text_v<T>)
+                {
+                    std::string_view text;
+
+                    if constexpr (std::is_array_v<T>)
+                    {
+                        text = std::string_view(val);
+                    }
+                    else if constexpr (std::is_pointer_v<T>)
+                    {
+                        text = val != nullptr ? std::string_view(val) : std::string_view("(null)");
+                    }
+                    else
+                    {
+                        text = val;
+                    }
+
+                    // Leave room for the length and terminator of the texts still to come.
+                    std::size_t room = static_cast<std::size_t>(end - p) - 3 - --left * 3;
+                    std::uint16_t n = static_cast<std::uint16_t>(text.size() < room ? text.size() : room);
+
+                    std::memcpy(p, &n, sizeof(n));
+                    std::memcpy(p + sizeof(n), text.data(), n);
+                    p[sizeof(n) + n] = '\0';
+                    p += sizeof(n) + n + 1;
+                }
+            }
+
+            template <typename T>
+            static log_arg_t<T> decode(const unsigned char*& vp, const unsigned char*& tp) noexcept
+            {
+                if constexpr (is_log_text_v<T>)
+                {
+                    std::uint16_t n = 0;
+                    std::memcpy(&n, tp, sizeof(n));
+                    const char* text = reinterpret_cast<const char*>(tp + sizeof(n));
+                    tp += sizeof(n) + n + 1;
+                    return text;
+                }
+                else
+                {
+                    log_arg_t<T> item;
+                    std::memcpy(&item, vp, sizeof(item));
+                    vp += sizeof(item);
+                    return item;
+                }
+            }
+        };
+
+        /**
+         * @brief Not `constexpr`, so reaching it while checking a format fails to compile with `what` in the message.
+         */
+        inline void log_format_error(const char* what) noexcept
+        {
+            (void)what;
+        }
+
+        /**
+         * @brief A format string checked at compile time against the arguments that follow it, as `printf` would be.
+         * @note `%s` takes text, `%d`/`%u`/`%x`/`%c`... an integer of the size the length modifier asks for, `%f`/`%e`/`%g`/`%a`
+         *       a floating point value and `%p` a pointer. A `*` width or precision takes an integer. `%n` is refused.
+         */
+        template <typename... Types>
+        struct log_format
+        {
+            const char*                                 value;
+
+            consteval log_format(const char* str)
+                : value(str)
+            {
+                enum class kind { text, integer, real, pointer };
+                const kind kinds[] = { kind::text, (is_log_text_v<Types> ? kind::text : std::is_integral_v<log_arg_t<Types>> || std::is_enum_v<log_arg_t<Types>> ? kind::integer :
+                                                    std::is_floating_point_v<log_arg_t<Types>> ? kind::real : kind::pointer)... };
+                const std::size_t sizes[] = { 0, sizeof(log_arg_t<Types>)... };
+                std::size_t i = 0;
+
+                auto take = [&] (kind want, std::size_t size) {
+                    if (++i > sizeof...(Types))
+                    {
+                        log_format_error("too few arguments for the format");
+                    }
+                    else if (kinds[i] != want && !(want == kind::pointer && kinds[i] == kind::text))
+                    {
+                        log_format_error("argument type does not match the conversion");
+                    }
+                    else if (want != kind::text && want != kind::pointer && (size == 0 ? sizes[i] > (want == kind::real ? sizeof(double) : sizeof(int)) : sizes[i] != size))
+                    {
+                        log_format_error("argument size does not match the length modifier");
+                    }
+                };
+
+                for (const char* p = str; *p != '\0'; ++p)
+                {
+                    if (*p != '%' || *++p == '%')
+                    {
+                        continue;
+                    }
+
+                    for (; *p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'; ++p);
+
+                    for (bool precision = false;; precision = true, ++p)
+                    {
+                        if (*p == '*')
+                        {
+                            take(kind::integer, sizeof(int)), ++p;
+                        }
+
+                        for (; *p >= '0' && *p <= '9'; ++p);
+
+                        if (precision || *p != '.')
+                        {
+                            break;
+                        }
+                    }
+
+                    std::size_t size = 0;
+
+                    switch (*p)
+                    {
+                    case 'h': p += p[1] == 'h' ? 2 : 1; break;
+                    case 'l': size = p[1] == 'l' ? sizeof(long long) : sizeof(long), p += p[1] == 'l' ? 2 : 1; break;
+                    case 'z': size = sizeof(std::size_t), ++p; break;
+                    case 'j': size = sizeof(std::intmax_t), ++p; break;
+                    case 't': size = sizeof(std::ptrdiff_t), ++p; break;
+                    case 'L': size = sizeof(long double), ++p; break;
+                    default: break;
+                    }
+
+                    switch (*p)
+                    {
+                    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c': take(kind::integer, size); break;
+                    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': take(kind::real, size); break;
+                    case 's': take(kind::text, size); break;
+                    case 'p': take(kind::pointer, size); break;
+                    default: log_format_error("unsupported conversion"); break;
+                    }
+
+                    if (*p == '\0')
+                    {
+                        break;
+                    }
+                }
+
+                if (i != sizeof...(Types))
+                {
+                    log_format_error("too many arguments for the format");
+                }
+            }
+        };
+    }
+
+    /**
+     * @brief Rate limit of one log call site, shared by all threads.
+     * @note Allows `limit` records per second, the records over the limit are counted and reported with the next
+     *       record that gets through.
+     */
+    class asio_log_site
+    {
+    public:
+        explicit asio_log_site(std::uint32_t limit = 10) noexcept
+            : limit(limit)
+        {
+        }
+    public:
+        /**
+         * @brief Take one record from the budget of the current second.
+         * @param suppressed - Receives the number of records dropped since the last one that got through.
+         * @return Returns `true` if the record may be logged.
+         */
+        bool allow(std::uint64_t& suppressed) noexcept
+        {
+            std::int64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            std::int64_t cur = window.load(std::memory_order_relaxed);
+
+            if (cur != now && window.compare_exchange_strong(cur, now, std::memory_order_relaxed))
+            {
+                count.store(0, std::memory_order_relaxed);
+            }
+
+            if (count.fetch_add(1, std::memory_order_relaxed) >= limit)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            suppressed = dropped.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    private:
+        std::uint32_t                                   limit;
+        std::atomic_int64_t                             window{ 0 };
+        std::atomic_uint32_t                            count{ 0 };
+        std::atomic_uint64_t                            dropped{ 0 };
+    };
+
+    /**
+     * @brief Bounded single-producer single-consumer queue of records, one per logging thread.
+     */
+    class asio_log_queue
+    {
+    public:
+        static constexpr std::size_t capacity = 1024;
+    public:
+        explicit asio_log_queue(std::uint32_t tid)
+            : records(std::make_unique<asio_log_record[]>(capacity))
+            , tid(tid)
+        {
+        }
+    public:
+        /**
+         * @brief Get the slot for the next record, or `nullptr` if the queue is full. Producer only.
+         */
+        asio_log_record* prepare() noexcept
+        {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            return t - head.load(std::memory_order_acquire) < capacity ? &records[t & (capacity - 1)] : nullptr;
+        }
+
+        /**
+         * @brief Publish the slot returned by `prepare`. Producer only.
+         */
+        void commit() noexcept
+        {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Pass every published record to `f` and release it. Consumer only.
+         * @return Returns the number of records consumed.
+         */
+        template <typename F>
+        std::size_t consume(F&& f)
+        {
+            std::size_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_acquire), n = t - h;
+
+            for (; h != t; ++h)
+            {
+                f(records[h & (capacity - 1)]);
+                head.store(h + 1, std::memory_order_release);
+            }
+
+            return n;
+        }
+
+        std::uint32_t id() const noexcept
+        {
+            return tid;
+        }
+    private:
+        std::unique_ptr<asio_log_record[]>              records;
+        std::uint32_t                                   tid;
+        alignas(64) std::atomic_size_t                  head{ 0 };
+        alignas(64) std::atomic_size_t                  tail{ 0 };
+    };
+
+    /**
+     * @brief Asynchronous logger used by the library.
+     * @note A log call copies its arguments in binary form into a queue owned by the calling thread and returns, it never
+     *       formats, takes a lock or blocks. If the queue is full the record is dropped and counted. A background thread
+     *       formats the records and hands each line to the sink, by default `stderr`. Use the `ASIO_LOG_*` macros, they
+     *       check the level first and rate limit every call site.
+     * @example
+     * ik::asio_logger::instance().set_level(ik::log_level::warn).set_sink([] (ik::log_level level, const std::string& line) {
+     *     fwrite(line.data(), 1, line.size(), stdout);
+     * });
+     * ASIO_LOG_ERROR("accept failed: %s (%d)", ec.message(), ec.value());
+     */
+    class asio_logger
+    {
+    public:
+        using sink_type = std::function<void(log_level, const std::string&)>;
+    public:
+        static asio_logger& instance()
+        {
+            static asio_logger logger;
+            return logger;
+        }
+
+        static bool enabled(log_level level) noexcept
+        {
+            return level >= instance().level.load(std::memory_order_relaxed);
+        }
+    private:
+        asio_logger()
+            : level(log_level::info)
+            , dropped(0)
+            , stopped(false)
+            , sink([] (log_level, const std::string& line) { fwrite(line.data(), 1, line.size(), stderr); })
+            , flusher([this] { this->run(); })
+        {
+        }
+    public:
+        virtual ~asio_logger()
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                stopped = true;
+            }
+
+            cv.notify_one();
+            flusher.join();
+            flush();
+        }
+    private:
+        asio_logger(const asio_logger&) = delete;
+        asio_logger& operator=(const asio_logger&) = delete;
+    public:
+        /**
+         * @brief Set the lowest level that is logged, `log_level::info` by default.
+         */
+        asio_logger& set_level(log_level val) noexcept
+        {
+            level.store(val, std::memory_order_relaxed);
+            return *this;
+        }
+
+        /**
+         * @brief Replace the sink that receives the formatted lines. The sink runs on the flusher thread.
+         */
+        asio_logger& set_sink(sink_type val)
+        {
+            std::unique_lock<std::mutex> lock(drain_mutex);
+            sink = std::move(val);
+            return *this;
+        }
+
+        /**
+         * @brief Queue a record. Called by the `ASIO_LOG_*` macros.
+         */
+        template <typename... Types>
+        void log(log_level lvl, std::uint64_t suppressed, detail::log_format<std::type_identity_t<Types>...> fmt, const Types&... args) noexcept
+        {
+            asio_log_queue* queue = local();
+            asio_log_record* record = queue != nullptr ? queue->prepare() : nullptr;
+
+            if (record == nullptr)
+            {
+                dropped.fetch_add(1 + suppressed, std::memory_order_relaxed);
+                return;
+            }
+
+            record->ts = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            record->fmt = fmt.value;
+            record->format = &detail::log_codec<Types...>::format;
+            record->suppressed = suppressed;
+            record->tid = queue->id();
+            record->level = lvl;
+            detail::log_codec<Types...>::encode(record->args, args...);
+            queue->commit();
+        }
+
+        /**
+         * @brief Format and write every queued record on the calling thread.
+         * @note Useful before `quick_exit` or when a test wants to see the output.
+         */
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(drain_mutex);
+            drain();
+        }
+    private:
+        void run()
+        {
+            for (std::unique_lock<std::mutex> lock(mutex); !stopped; cv.wait_for(lock, std::chrono::milliseconds(10)))
+            {
+                lock.unlock();
+                flush();
+                lock.lock();
+            }
+        }
+
+        /**
+         * @brief Consume all queues, `drain_mutex` must be held so there is only one consumer.
+         */
+        void drain()
+        {
+            std::vector<asio_log_queue*> list;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                for (const auto& queue : queues)
+                {
+                    list.emplace_back(queue.get());
+                }
+            }
+
+            std::string line;
+
+            if (std::uint64_t n = dropped.exchange(0, std::memory_order_relaxed); n != 0)
+            {
+                line = "log queue full, " + std::to_string(n) + " records dropped\n";
+                write(log_level::warn, line);
+            }
+
+            for (asio_log_queue* queue : list)
+            {
+                queue->consume([&] (const asio_log_record& record) {
+                    line.clear();
+                    prefix(line, record);
+                    record.format(line, record.fmt, record.args);
+
+                    if (record.suppressed != 0)
+                    {
+                        line += " (" + std::to_string(record.suppressed) + " similar suppressed)";
+                    }
+
+                    line += '\n';
+                    write(record.level, line);
+                });
+            }
+        }
+
+        void write(log_level lvl, const std::string& line)
+        {
+            try
+            {
+                if (sink)
+                {
+                    sink(lvl, line);
+                }
+            }
+            catch (const std::exception&)
+            {
+                // A failing sink must not stop the flusher.
+            }
+        }
+
+        static void prefix(std::string& line, const asio_log_record& record)
+        {
+            static const char* names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+
+            std::time_t sec = static_cast<std::time_t>(record.ts / 1000000000);
+            std::tm tm{};
+#if defined(_WIN32)
+            gmtime_s(&tm, &sec);
+#else
+            gmtime_r(&sec, &tm);
+#endif
+            char buf[64];
+            int n = std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ %-5s [%u] ",
+                                  tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                                  static_cast<int>(record.ts % 1000000000 / 1000), names[static_cast<std::size_t>(record.level)], record.tid);
+            line.append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+        }
+
+        asio_log_queue* local() noexcept
+        {
+            thread_local asio_log_queue* queue = attach();
+            return queue;
+        }
+
+        /**
+         * @brief Create and register the queue of the calling thread. Queues outlive their threads so nothing is lost.
+         */
+        asio_log_queue* attach() noexcept
+        {
+            try
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                return queues.emplace_back(std::make_unique<asio_log_queue>(static_cast<std::uint32_t>(queues.size() + 1))).get();
+            }
+            catch (const std::exception&)
+            {
+                return nullptr;
+            }
+        }
+    private:
+        std::atomic<log_level>                                                 level;
+        std::atomic_uint64_t                                                   dropped;
+        bool                                                                   stopped;
+        std::mutex                                                             mutex;
+        std::mutex                                                             drain_mutex;
+        std::condition_variable                                                cv;
+        std::vector<std::unique_ptr<asio_log_queue>>                           queues;
+        sink_type                                                              sink;
+        std::thread                                                            flusher;
+    };
+}
+
+/**
+ * @brief Log a printf-style message if `level` is enabled, at most 10 times per second per call site.
+ * @note The format string must be a literal, it is checked against the arguments at compile time. Arguments are
+ *       formatted on the flusher thread, so pass text as `std::string`/`const char*` (it is copied) and everything else by value.
+ */
+#define ASIO_LOG(level, ...)                                                                                        \
+    do                                                                                                              \
+    {                                                                                                               \
+        static ::ik::asio_log_site asio_log_site_;                                                                  \
+        std::uint64_t asio_log_suppressed_ = 0;                                                                     \
+        if (::ik::asio_logger::enabled(level) && asio_log_site_.allow(asio_log_suppressed_))                       \
+        {                                                                                                           \
+            ::ik::asio_logger::instance().log(level, asio_log_suppressed_, __VA_ARGS__);                            \
+        }                                                                                                           \
+    } while (0)
+
+#define ASIO_LOG_DEBUG(...) ASIO_LOG(::ik::log_level::debug, __VA_ARGS__)
+#define ASIO_LOG_INFO(...) ASIO_LOG(::ik::log_level::info, __VA_ARGS__)
+#define ASIO_LOG_WARN(...) ASIO_LOG(::ik::log_level::warn, __VA_ARGS__)
+#define ASIO_LOG_ERROR(...) ASIO_LOG(::ik::log_level::error, __VA_ARGS__)
+
+#endif // __ASIO_LOG_H__
\ No newline at end of file
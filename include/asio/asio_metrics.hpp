@@ -0,0 +1,309 @@
+﻿#ifndef __ASIO_METRICS_H__
+#define __ASIO_METRICS_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_histogram.hpp"
+
+#include <asio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ik
+{
+    /**
+     * @brief Counters kept per context and, for the first five, per session.
+     * @note `queue_depth` and `sessions` are gauges and go up and down, everything else only grows.
+     */
+    enum class metric_type : std::size_t
+    {
+        bytes_in,
+        bytes_out,
+        messages_in,
+        messages_out,
+        queue_depth,
+        sessions,
+        accepts,
+        connects,
+        disconnects,
+        handshakes,
+        resumptions,
+        migrations,
+        throttled,
+        conflated,
+        errors,
+        max
+    };
+
+    /**
+     * @brief Number of occurrences of one error code.
+     */
+    struct asio_error_count
+    {
+        std::string                                     category;
+        int                                             code;
+        std::string                                     message;
+        std::uint64_t                                   count;
+    };
+
+    /**
+     * @brief Point-in-time copy of a set of counters.
+     */
+    struct asio_metrics_snapshot
+    {
+        std::array<std::int64_t, static_cast<std::size_t>(metric_type::max)>  values{};
+        std::vector<asio_error_count>                                          errors;
+
+        std::int64_t operator[](metric_type type) const noexcept
+        {
+            return values[static_cast<std::size_t>(type)];
+        }
+
+        /**
+         * @brief Add the counters of another snapshot, merging error counts with the same category and code.
+         */
+        asio_metrics_snapshot& operator+=(const asio_metrics_snapshot& other)
+        {
+            for (std::size_t i = 0; i < values.size(); ++i)
+            {
+                values[i] += other.values[i];
+            }
+
+            for (const asio_error_count& item : other.errors)
+            {
+                auto it = std::find_if(errors.begin(), errors.end(), [&] (const asio_error_count& cur) {
+                    return cur.code == item.code && cur.category == item.category;
+                });
+
+                if (it == errors.end())
+                {
+                    errors.emplace_back(item);
+                }
+                else
+                {
+                    it->count += item.count;
+                }
+            }
+
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Counters of one session.
+     * @note A session only runs on the thread of its context, so the counters are written by a single thread and
+     *       relaxed atomics are enough. They share one cache line, away from the rest of the session.
+     */
+    class alignas(64) asio_session_metrics
+    {
+    public:
+        static constexpr std::size_t counter_cnt = static_cast<std::size_t>(metric_type::queue_depth) + 1;
+    public:
+        void add(metric_type type, std::int64_t n = 1) noexcept
+        {
+            counters[static_cast<std::size_t>(type)].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        std::int64_t get(metric_type type) const noexcept
+        {
+            return counters[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+        }
+
+        asio_metrics_snapshot snapshot() const
+        {
+            asio_metrics_snapshot result;
+
+            for (std::size_t i = 0; i < counter_cnt; ++i)
+            {
+                result.values[i] = counters[i].load(std::memory_order_relaxed);
+            }
+
+            return result;
+        }
+    private:
+        std::array<std::atomic_int64_t, counter_cnt>                           counters{};
+    };
+
+    /**
+     * @brief Counters of one context.
+     * @note Every thread writes its own cache-line-aligned shard, picked once per thread, so the recv/send path costs an
+     *       uncontended relaxed add and never bounces a line between threads. `snapshot` sums the shards on demand.
+     *       Errors are counted per category and code in a small lock-free table; codes beyond its capacity are
+     *       still counted in `metric_type::errors` but not broken down.
+     *       Latency histograms (handler time per event type, loop lag) are allocated once per context, on the heap
+     *       because of their size.
+     */
+    class asio_metrics
+    {
+    public:
+        static constexpr std::size_t shard_cnt = 16;
+        static constexpr std::size_t error_cnt = 64;
+        static constexpr std::size_t handler_cnt = 16;
+    private:
+        struct alignas(64) shard
+        {
+            std::array<std::atomic_int64_t, static_cast<std::size_t>(metric_type::max)> values{};
+        };
+
+        struct error_slot
+        {
+            std::atomic<const asio::error_category*>    category{ nullptr };
+            std::atomic_int                             code{ 0 };
+            std::atomic_bool                            ready{ false };
+            std::atomic_uint64_t                        count{ 0 };
+        };
+    public:
+        asio_metrics()
+            : histograms(std::make_unique<std::array<asio_histogram, handler_cnt + 1>>())
+        {
+        }
+        virtual ~asio_metrics() = default;
+    private:
+        asio_metrics(const asio_metrics&) = delete;
+        asio_metrics& operator=(const asio_metrics&) = delete;
+    public:
+        /**
+         * @brief Add `n` to a counter (or subtract, for a negative `n` on a gauge).
+         */
+        void add(metric_type type, std::int64_t n = 1) noexcept
+        {
+            shards[shard_idx()].values[static_cast<std::size_t>(type)].fetch_add(n, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Count an error, both in `metric_type::errors` and under its category and code.
+         * @param ec - The error to count, ignored if it does not hold an error.
+         */
+        void error(const asio::error_code& ec) noexcept
+        {
+            if (!ec)
+            {
+                return;
+            }
+
+            add(metric_type::errors);
+
+            const asio::error_category* category = std::addressof(ec.category());
+            std::size_t hash = (std::hash<const void*>{}(category) ^ static_cast<std::size_t>(ec.value()) * 0x9E3779B97F4A7C15ull) % error_cnt;
+
+            for (std::size_t i = 0; i < error_cnt; ++i)
+            {
+                error_slot& slot = errors[(hash + i) % error_cnt];
+                const asio::error_category* cur = slot.category.load(std::memory_order_acquire);
+
+                if (cur == nullptr)
+                {
+                    // Claim the slot, a racing thread with the same code may claim another one, snapshots merge them.
+                    if (!slot.category.compare_exchange_strong(cur, category, std::memory_order_acq_rel))
+                    {
+                        continue;
+                    }
+
+                    slot.code.store(ec.value(), std::memory_order_relaxed);
+                    slot.count.fetch_add(1, std::memory_order_relaxed);
+                    slot.ready.store(true, std::memory_order_release);
+                    return;
+                }
+
+                if (cur == category && slot.ready.load(std::memory_order_acquire) && slot.code.load(std::memory_order_relaxed) == ec.value())
+                {
+                    slot.count.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief Get the histogram of handler execution times, in nanoseconds, for one event type.
+         * @param type - The event type, as the index of its `bind_type`.
+         */
+        asio_histogram& handler(std::size_t type) noexcept
+        {
+            return (*histograms)[type % handler_cnt];
+        }
+
+        const asio_histogram& handler(std::size_t type) const noexcept
+        {
+            return (*histograms)[type % handler_cnt];
+        }
+
+        /**
+         * @brief Get the histogram of the loop lag, in nanoseconds, i.e. how long a posted handler waited before it ran.
+         */
+        asio_histogram& lag() noexcept
+        {
+            return (*histograms)[handler_cnt];
+        }
+
+        const asio_histogram& lag() const noexcept
+        {
+            return (*histograms)[handler_cnt];
+        }
+
+        /**
+         * @brief Sum the shards of a counter.
+         */
+        std::int64_t get(metric_type type) const noexcept
+        {
+            std::int64_t n = 0;
+
+            for (const shard& item : shards)
+            {
+                n += item.values[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+            }
+
+            return n;
+        }
+
+        /**
+         * @brief Copy every counter and error count.
+         * @return Returns the aggregated counters of all threads that wrote to this context.
+         */
+        asio_metrics_snapshot snapshot() const
+        {
+            asio_metrics_snapshot result;
+
+            for (std::size_t i = 0; i < result.values.size(); ++i)
+            {
+                result.values[i] = get(static_cast<metric_type>(i));
+            }
+
+            asio_metrics_snapshot table;
+
+            for (const error_slot& slot : errors)
+            {
+                if (slot.ready.load(std::memory_order_acquire))
+                {
+                    const asio::error_category* category = slot.category.load(std::memory_order_relaxed);
+                    int code = slot.code.load(std::memory_order_relaxed);
+                    table.errors.emplace_back(asio_error_count{ category->name(), code, category->message(code), slot.count.load(std::memory_order_relaxed) });
+                }
+            }
+
+            table.values.fill(0);
+            return result += table;
+        }
+    private:
+        static std::size_t shard_idx() noexcept
+        {
+            static std::atomic_size_t next{ 0 };
+            thread_local std::size_t idx = next.fetch_add(1, std::memory_order_relaxed) % shard_cnt;
+            return idx;
+        }
+    private:
+        std::array<shard, shard_cnt>                                           shards;
+        std::array<error_slot, error_cnt>                                      errors;
+        std::unique_ptr<std::array<asio_histogram, handler_cnt + 1>>           histograms;
+    };
+}
+
+#endif // __ASIO_METRICS_H__
\ No newline at end of file
@@ -5,7 +5,11 @@
 #	pragma once
 #endif
 
-#include <iostream>
+#include "asio_context.hpp"
+#include "asio_log.hpp"
+#include "asio_trace.hpp"
+
+#include <chrono>
 #include <type_traits>
 #include <functional>
 #include <unordered_map>
@@ -87,6 +91,16 @@ namespace ik
          * });
          */
         connect,
+
+        /**
+         * @brief Connection timeout event
+         * @note Triggered when a connection attempt does not complete within the client's connect deadline,
+         *       right before `connect` reports the `asio::error::timed_out` failure
+         * @example
+         * binder.add(bind_type::connect_timeout, [&] (asio_event& context, asio_socket& socket, asio_error& ec) {
+         *     // Record the slow endpoint
+         * });
+         */
         connect_timeout,
 
         /**
@@ -112,6 +126,17 @@ namespace ik
          */
         accept,
 
+        /**
+         * @brief Session migration event
+         * @note Triggered on the target context once a session moved there by `migrate`, used to replace the old session
+         * @example
+         * binder.add(bind_type::migrate, [&] (asio_event& context, asio_session& session, asio_error& ec) {
+         *     // Keep the moved session in place of the old one and start it on its new context
+         *     (sessions[session.index()] = std::make_shared<asio_session>(std::move(session)))->init();
+         * });
+         */
+        migrate,
+
         /**
          * @brief Maximum value of the enumeration
          * @note Used to represent the maximum value of the enumeration, typically for iteration or boundary checking to avoid out-of-bounds errors
@@ -149,6 +174,7 @@ namespace ik
             using type = T;
         };
 
+#if defined(_MSC_VER)
         template <typename T, typename... Types>
         struct function_traits<T(__cdecl)(Types...)>
         {
@@ -226,6 +252,25 @@ namespace ik
         {
             using type = T(Types...);
         };
+#else
+        template <typename T, typename... Types>
+        struct function_traits<T(Types...)>
+        {
+            using type = T(Types...);
+        };
+
+        template <typename T, typename... Types>
+        struct function_traits<T(&)(Types...)>
+        {
+            using type = T(Types...);
+        };
+
+        template <typename T, typename C, typename... Types>
+        struct function_traits<T(C::*)(Types...)>
+        {
+            using type = T(Types...);
+        };
+#endif
 
         template <typename T>
         struct function_traits_of
@@ -276,9 +321,6 @@ namespace ik
         };
 
         // std::bind
-        template <typename R, typename F, typename... Types>
-        using function_bind = std::_Binder<R, F, Types ...>;
-
         template <typename T>
         struct function_bind_traits;
 
@@ -288,6 +330,10 @@ namespace ik
             using type = T;
         };
 
+#if defined(_MSVC_STL_VERSION)
+        template <typename R, typename F, typename... Types>
+        using function_bind = std::_Binder<R, F, Types ...>;
+
         // std::bind ref
         // class std::_Binder<struct std::_Unforced,void (__cdecl&)(int,int),struct std::_Ph<1> const &,struct std::_Ph<2> const &>
         template <typename R, typename F>
@@ -315,11 +361,26 @@ namespace ik
         {
             using type = F;
         };
+#elif defined(__GLIBCXX__)
+        // class std::_Bind<void (*(std::_Placeholder<1>, std::_Placeholder<2>))(int, int)>
+        template <typename F, typename... Types>
+        struct function_bind_traits<std::_Bind<F(Types...)>>
+        {
+            using type = std::remove_pointer_t<F>;
+        };
+#elif defined(_LIBCPP_VERSION)
+        // class std::__bind<void (*)(int, int), const std::placeholders::__ph<1>&, const std::placeholders::__ph<2>&>
+        template <typename F, typename... Types>
+        struct function_bind_traits<std::__bind<F, Types...>>
+        {
+            using type = std::remove_pointer_t<F>;
+        };
+#endif
 
         template <typename T>
         struct function_bind_traits_of
         {
-            using type = typename std::remove_pointer_t<typename function_lambda_traits_if<typename function_bind_traits<T>::type>>::type;
+            using type = std::remove_pointer_t<typename function_lambda_traits_if<typename function_bind_traits<T>::type>::type>;
         };
 
         template <typename T, typename E = void>
@@ -356,6 +417,7 @@ namespace ik
         template <typename T, template <typename, typename...> typename ImplType>
         struct function_analysis {};
 
+#if defined(_MSC_VER)
         // Function pointer
         template <typename T, typename... Types, template <typename, typename...> typename ImplType>
         struct function_analysis<T(__cdecl)(Types...), ImplType>
@@ -411,11 +473,27 @@ namespace ik
         {
             using type = ImplType<T, Types...>;
         };
+#else
+        // Function pointer
+        template <typename T, typename... Types, template <typename, typename...> typename ImplType>
+        struct function_analysis<T(Types...), ImplType>
+        {
+            using type = ImplType<T, Types...>;
+        };
+
+        // Member function pointer
+        template <typename T, typename C, typename... Types, template <typename, typename...> typename ImplType>
+        struct function_analysis<T(C::*)(Types...), ImplType>
+        {
+            using type = ImplType<T, Types...>;
+        };
+#endif
     }
 
     template <typename R, typename... Types>
     struct observer_wrapper_callable_base
     {
+        virtual ~observer_wrapper_callable_base() noexcept = default;
         virtual R invoke(Types&&...) = 0;
     };
 
@@ -443,15 +521,20 @@ namespace ik
             }
             catch (const std::bad_function_call& ex)
             {
-                std::cerr << "Caught std::bad_function_call: " << ex.what() << std::endl;
+                ASIO_LOG_ERROR("Caught std::bad_function_call: %s", ex.what());
             }
             catch (const std::exception& ex)
             {
-                std::cerr << "Caught exception: " << ex.what() << std::endl;
+                ASIO_LOG_ERROR("Caught exception: %s", ex.what());
             }
             catch (...)
             {
-                std::cerr << "Caught unknown exception!" << std::endl;
+                ASIO_LOG_ERROR("Caught unknown exception!");
+            }
+
+            if constexpr (!std::is_void_v<return_type>)
+            {
+                return return_type{};
             }
         }
     private:
@@ -479,7 +562,7 @@ namespace ik
         }
         virtual ~observer_impl() noexcept
         {
-            if (ptr) { delete ptr; }
+            if (ptr) { delete static_cast<callable_type*>(ptr); }
         }
     public:
         /**
@@ -527,6 +610,9 @@ namespace ik
 
     class asio_binder
     {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        using slow_handler_type = std::function<void(bind_type, const std::chrono::nanoseconds&)>;
     public:
         /**
          * @brief Add an observer for a specific event type.
@@ -567,6 +653,16 @@ namespace ik
             return *this;
         }
 
+        /**
+         * @brief Check if an observer is registered for an event type.
+         */
+        template <typename T = bind_type>
+        inline bool has(T&& e) const noexcept
+        {
+            auto it = observers.find(static_cast<bind_type>(e));
+            return it != observers.end() && it->second != nullptr;
+        }
+
         /**
          * @brief Notify the observer for a specific event type.
          * @tparam R - The return type of the observer function (default is `void`).
@@ -579,19 +675,67 @@ namespace ik
         template <typename R = void, typename T = bind_type, typename... Types>
         inline auto notify(T&& e, Types&&... args) noexcept
         {
-            if (observers[std::forward<T>(e)] == nullptr)
+            bind_type type = static_cast<bind_type>(e);
+            observer_impl<R, Types...>* ptr = static_cast<observer_impl<R, Types...>*>(observers[type].get());
+
+            if (ptr == nullptr)
             {
                 return R{};
             }
 
-            observer_impl<R, Types...>* ptr = static_cast<observer_impl<R, Types...>*>(observers[std::forward<T>(e)].get());
+            ASIO_TRACE_SCOPE(dispatch, type, 0);
 
-            if (ptr)
+            // Handlers are only timed on a thread running a context, the timing goes to that context.
+            asio_context* context = profiling ? asio_context::current() : nullptr;
+
+            if (context == nullptr)
             {
                 return ptr->call(std::forward<Types>(args)...);
             }
 
-            return R{};
+            clock_type::time_point start = clock_type::now();
+
+            if constexpr (std::is_void_v<R>)
+            {
+                ptr->call(std::forward<Types>(args)...);
+                record(*context, type, start);
+            }
+            else
+            {
+                R result = ptr->call(std::forward<Types>(args)...);
+                record(*context, type, start);
+                return result;
+            }
+        }
+
+        /**
+         * @brief Enable or disable timing of the handlers.
+         * @param enable - `true` to record the execution time of every handler, the default.
+         * @return Returns a reference to the current `asio_binder` object to support chaining.
+         * @note Timings are recorded in `asio_metrics::handler()` of the context running the handler.
+         */
+        asio_binder& set_profiling(bool enable) noexcept
+        {
+            profiling = enable;
+            return *this;
+        }
+
+        /**
+         * @brief Set a callback for handlers that run longer than a threshold.
+         * @param threshold - The execution time from which a handler counts as slow.
+         * @param handler - Called on the same thread, right after the slow handler returned, with its event type and time.
+         * @return Returns a reference to the current `asio_binder` object to support chaining.
+         * @note A slow `recv` handler delays every other session of its context, this is the hook to find them.
+         * @example
+         * binder.set_slow_handler(std::chrono::milliseconds(1), [] (bind_type e, const std::chrono::nanoseconds& elapsed) {
+         *     printf("handler %zu took %lld ns\n", static_cast<std::size_t>(e), static_cast<long long>(elapsed.count()));
+         * });
+         */
+        asio_binder& set_slow_handler(const std::chrono::nanoseconds& threshold, slow_handler_type handler)
+        {
+            slow_threshold = threshold;
+            slow_handler = std::move(handler);
+            return *this;
         }
 
         /**
@@ -612,9 +756,33 @@ namespace ik
             co_return this->notify(std::forward<T>(e), std::forward<Types>(args)...);
         }
 #endif
+    private:
+        void record(asio_context& context, bind_type type, const clock_type::time_point& start) noexcept
+        {
+            std::chrono::nanoseconds elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start);
+
+            context.get_metrics().handler(static_cast<std::size_t>(type)).record(static_cast<std::uint64_t>(elapsed.count()));
+
+            if (slow_handler && elapsed >= slow_threshold)
+            {
+                try
+                {
+                    slow_handler(type, elapsed);
+                }
+                catch (const std::exception&)
+                {
+                    // Exception handling (e.g., logging) can be added here.
+                }
+            }
+        }
     private:
         std::unordered_map<bind_type, std::unique_ptr<observer_base>> observers;
+        bool                                                          profiling = true;
+        std::chrono::nanoseconds                                      slow_threshold{ 0 };
+        slow_handler_type                                             slow_handler;
     };
+
+    static_assert(static_cast<std::size_t>(bind_type::max) <= asio_metrics::handler_cnt, "asio_metrics keeps too few handler histograms");
 }
 
 #endif // __ASIO_OBSERVICE_H__
\ No newline at end of file
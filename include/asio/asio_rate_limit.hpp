@@ -0,0 +1,347 @@
+﻿#ifndef __ASIO_RATE_LIMIT_H__
+#define __ASIO_RATE_LIMIT_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace ik
+{
+    using asio_rate_clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Rates a session, or all the sessions of a context together, may not exceed.
+     * @note A rate of `0` is no limit. Every bucket holds `burst` worth of its rate, so a quiet connection may send
+     *       that much at once. `in_messages` counts reads, as `metric_type::messages_in` does.
+     */
+    struct asio_rate_limit
+    {
+        double                                          in_bytes = 0;                               // per second
+        double                                          in_messages = 0;                            // per second
+        double                                          out_bytes = 0;                              // per second
+        std::chrono::milliseconds                       burst{ 1000 };
+    };
+
+    /**
+     * @brief A token bucket refilled at `rate` tokens per second up to `capacity`.
+     * @note Tokens are taken after the fact and the balance may go negative, a caller then waits until the debt is
+     *       paid back. A read of unknown size or a message larger than the bucket is charged in full that way,
+     *       and the average stays at `rate`.
+     */
+    struct asio_token_bucket
+    {
+        double                                          rate = 0;
+        double                                          capacity = 0;
+        double                                          tokens = 0;
+        asio_rate_clock::time_point                     stamp{};
+
+        /**
+         * @brief Set the rate and capacity, and fill the bucket.
+         */
+        void reset(double value, double size) noexcept
+        {
+            rate = std::max(value, 0.0), capacity = std::max(size, 1.0), tokens = capacity, stamp = asio_rate_clock::now();
+        }
+
+        /**
+         * @brief Take `n` tokens.
+         * @return Returns how long to wait until the balance is positive again, zero if it still is or the bucket has no rate.
+         */
+        asio_rate_clock::duration take(double n, const asio_rate_clock::time_point& now) noexcept
+        {
+            if (rate <= 0)
+            {
+                return asio_rate_clock::duration::zero();
+            }
+
+            if (now > stamp)
+            {
+                tokens = std::min(capacity, tokens + rate * std::chrono::duration<double>(now - stamp).count()), stamp = now;
+            }
+
+            if ((tokens -= n) >= 0)
+            {
+                return asio_rate_clock::duration::zero();
+            }
+
+            return std::chrono::ceil<asio_rate_clock::duration>(std::chrono::duration<double>(-tokens / rate));
+        }
+    };
+
+    /**
+     * @brief The buckets of one `asio_rate_limit`.
+     */
+    struct asio_rate_buckets
+    {
+        asio_token_bucket                               in_bytes;
+        asio_token_bucket                               in_messages;
+        asio_token_bucket                               out_bytes;
+
+        void configure(const asio_rate_limit& limit) noexcept
+        {
+            double burst = std::chrono::duration<double>(limit.burst).count();
+
+            in_bytes.reset(limit.in_bytes, limit.in_bytes * burst);
+            in_messages.reset(limit.in_messages, limit.in_messages * burst);
+            out_bytes.reset(limit.out_bytes, limit.out_bytes * burst);
+        }
+
+        bool limited() const noexcept
+        {
+            return in_bytes.rate > 0 || in_messages.rate > 0 || out_bytes.rate > 0;
+        }
+
+        /**
+         * @brief Charge `messages` reads of `n` bytes in all, and get the time the reader has to pause.
+         */
+        asio_rate_clock::duration inbound(std::size_t n, std::size_t messages, const asio_rate_clock::time_point& now) noexcept
+        {
+            return std::max(in_bytes.take(static_cast<double>(n), now), in_messages.take(static_cast<double>(messages), now));
+        }
+
+        /**
+         * @brief Charge a write of `n` bytes and get the time the writer has to wait before sending it.
+         */
+        asio_rate_clock::duration outbound(std::size_t n, const asio_rate_clock::time_point& now) noexcept
+        {
+            return out_bytes.take(static_cast<double>(n), now);
+        }
+    };
+
+    /**
+     * @brief The rate budget shared by all sessions of a context, and the clock waking the sessions it paused.
+     * @note Paused readers and writers are kept in one list ordered by wake-up time, and a single timer running on a
+     *       strand of the context sleeps until the first of them. Thousands of throttled sessions cost one pending
+     *       timer instead of one each. The clock runs only while sessions wait, and keeps the context from running out of work.
+     * @example
+     * asio_rate_limit budget;
+     * budget.in_bytes = 64 << 20;
+     * server->get_group().get_context(0).get_limiter().set_budget(budget);
+     */
+    class asio_rate_limiter
+    {
+    public:
+        explicit asio_rate_limiter(asio::io_context& io_context)
+            : io_context(io_context)
+            , active(false)
+            , ticking(false)
+            , timer(nullptr)
+        {
+        }
+        virtual ~asio_rate_limiter() = default;
+    private:
+        asio_rate_limiter(const asio_rate_limiter&) = delete;
+        asio_rate_limiter& operator=(const asio_rate_limiter&) = delete;
+    public:
+        /**
+         * @brief Set the rates all sessions of the context share, from any thread. A default `asio_rate_limit` removes them.
+         */
+        void set_budget(const asio_rate_limit& limit)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            budget.configure(limit);
+            active.store(budget.limited(), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Check if the context has a budget, without taking the lock.
+         */
+        bool limited() const noexcept
+        {
+            return active.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Charge a read to the context budget, see `asio_rate_buckets::inbound`.
+         */
+        asio_rate_clock::duration inbound(std::size_t n, std::size_t messages, const asio_rate_clock::time_point& now)
+        {
+            if (!limited())
+            {
+                return asio_rate_clock::duration::zero();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            return budget.inbound(n, messages, now);
+        }
+
+        /**
+         * @brief Charge a write to the context budget, see `asio_rate_buckets::outbound`.
+         */
+        asio_rate_clock::duration outbound(std::size_t n, const asio_rate_clock::time_point& now)
+        {
+            if (!limited())
+            {
+                return asio_rate_clock::duration::zero();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            return budget.outbound(n, now);
+        }
+
+        /**
+         * @brief Wait until `due` on the context's clock.
+         * @param owner - Who waits, so `cancel` can wake it early, usually the session.
+         * @param due - The time to wake up.
+         * @param token - The completion token, the handler runs on its associated executor with `operation_aborted` if cancelled.
+         */
+        template <typename Token>
+        auto async_wait(const void* owner, const asio_rate_clock::time_point& due, Token&& token)
+        {
+            return asio::async_initiate<Token, void(asio_error)>([this, owner, due] (auto handler)
+            {
+                auto resume = std::make_shared<decltype(handler)>(std::move(handler));
+
+                enqueue(owner, due, [resume] (const asio_error& ec)
+                {
+                    auto executor = asio::get_associated_executor(*resume);
+                    asio::post(executor, [resume, ec] { std::move(*resume)(ec); });
+                });
+            }, token);
+        }
+
+        /**
+         * @brief Wake the waits of `owner` at once, e.g. when a session closes.
+         */
+        void cancel(const void* owner)
+        {
+            std::vector<std::function<void(const asio_error&)>> woken;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                for (auto it = waiters.begin(); it != waiters.end();)
+                {
+                    if (it->second.owner == owner)
+                    {
+                        woken.emplace_back(std::move(it->second.resume));
+                        it = waiters.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+            for (auto& resume : woken)
+            {
+                resume(asio::error::operation_aborted);
+            }
+        }
+
+        /**
+         * @brief Drop the waits without running them, before the context is destroyed.
+         */
+        void clear()
+        {
+            std::multimap<asio_rate_clock::time_point, waiter> dropped;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                dropped.swap(waiters);
+                clock.reset();
+            }
+        }
+    private:
+        struct waiter
+        {
+            const void*                                 owner;
+            std::function<void(const asio_error&)>      resume;
+        };
+
+        /**
+         * @brief Add a wait, starting the clock, or moving it forward if this wait is the first due.
+         */
+        void enqueue(const void* owner, const asio_rate_clock::time_point& due, std::function<void(const asio_error&)> resume)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bool first = waiters.empty() || due < waiters.begin()->first;
+
+            waiters.emplace(due, waiter{ owner, std::move(resume) });
+
+            if (!clock)
+            {
+                clock.emplace(io_context.get_executor());
+            }
+
+            if (!std::exchange(ticking, true))
+            {
+                asio::co_spawn(*clock, tick(), asio::detached);
+            }
+            else if (first)
+            {
+                asio::post(*clock, [this] { if (timer != nullptr) timer->cancel(); });
+            }
+        }
+
+        /**
+         * @brief Coroutine running the clock on its strand, it wakes every wait that is due and sleeps until the next one.
+         */
+        asio::awaitable<void> tick()
+        {
+            asio_error ec;
+            asio::steady_timer wheel(io_context);
+
+            for (timer = std::addressof(wheel);;)
+            {
+                std::vector<std::function<void(const asio_error&)>> woken;
+                asio_rate_clock::time_point next;
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    asio_rate_clock::time_point now = asio_rate_clock::now();
+
+                    while (!waiters.empty() && waiters.begin()->first <= now)
+                    {
+                        woken.emplace_back(std::move(waiters.begin()->second.resume));
+                        waiters.erase(waiters.begin());
+                    }
+
+                    if (waiters.empty() && woken.empty())
+                    {
+                        timer = nullptr, ticking = false;
+                        co_return;
+                    }
+
+                    next = waiters.empty() ? now : waiters.begin()->first;
+                }
+
+                for (auto& resume : woken)
+                {
+                    resume(asio_error());
+                }
+
+                if (woken.empty())
+                {
+                    wheel.expires_at(next);
+                    co_await wheel.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+                }
+            }
+        }
+    private:
+        asio::io_context&                               io_context;
+        std::mutex                                      mutex;
+        asio_rate_buckets                               budget;
+        std::atomic_bool                                active;
+        std::multimap<asio_rate_clock::time_point, waiter> waiters;
+        std::optional<asio::strand<asio::io_context::executor_type>> clock;
+        bool                                            ticking;                                    // the clock coroutine runs
+        asio::steady_timer*                             timer;                                      // its timer, used on its strand only
+    };
+}
+
+#endif // __ASIO_RATE_LIMIT_H__
\ No newline at end of file
@@ -0,0 +1,246 @@
+﻿#ifndef __ASIO_RESOLVER_CACHE_H__
+#define __ASIO_RESOLVER_CACHE_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ik
+{
+    /**
+     * @brief Shared cache in front of the asynchronous resolver.
+     * @note Entries are kept for `ttl` and, for failed lookups, `negative_ttl`. Expired positive entries are still served
+     *       for `stale_ttl` while a single background lookup refreshes them. Concurrent misses on the same host and service
+     *       share one lookup. The cache may be used from any context; lookups run on the context of the first caller.
+     *       Entries past their stale time are pruned once the map doubles in size since the last pruning.
+     */
+    class asio_resolver_cache
+    {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        using endpoints_type = std::vector<asio_endpoint>;
+        using result_type = std::pair<asio_error, endpoints_type>;
+    private:
+        struct entry
+        {
+            asio_error                                  ec;
+            endpoints_type                              endpoints;
+            clock_type::time_point                      expiry;
+            clock_type::time_point                      stale;
+            bool                                        valid = false;
+            bool                                        resolving = false;
+            std::vector<std::function<void(const result_type&)>> waiters;   // resume the callers sharing the lookup
+        };
+    public:
+        explicit asio_resolver_cache(const std::chrono::seconds& ttl = std::chrono::seconds(30),
+                                     const std::chrono::seconds& negative_ttl = std::chrono::seconds(5),
+                                     const std::chrono::seconds& stale_ttl = std::chrono::seconds(60))
+            : ttl(ttl)
+            , negative_ttl(negative_ttl)
+            , stale_ttl(stale_ttl)
+        {
+        }
+        virtual ~asio_resolver_cache() = default;
+    private:
+        asio_resolver_cache(const asio_resolver_cache&) = delete;
+        asio_resolver_cache& operator=(const asio_resolver_cache&) = delete;
+    public:
+        /**
+         * @brief Get the process-wide resolver cache.
+         * @return Returns a reference to the shared `asio_resolver_cache` instance.
+         */
+        static asio_resolver_cache& instance()
+        {
+            static asio_resolver_cache cache;
+            return cache;
+        }
+
+        /**
+         * @brief Coroutine to resolve a host name and service through the cache.
+         * @param io_context - The context used for a lookup if one has to be started.
+         * @param hostname - The host name (or address) to resolve.
+         * @param service - The service name or port number.
+         * @return Returns the error of the lookup and the resolved endpoints, in the order returned by the system.
+         * @note This function is a coroutine and must be awaited.
+         */
+        asio::awaitable<result_type> async_resolve(asio_context& io_context, const std::string& hostname, const std::string& service)
+        {
+            std::string key = hostname + ":" + service;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                clock_type::time_point now = clock_type::now();
+
+                if (entries.size() >= prune_at && !entries.contains(key))
+                {
+                    prune(now);
+                }
+
+                entry& item = entries[key];
+
+                if (item.valid && now < item.expiry)
+                {
+                    co_return result_type(item.ec, item.endpoints);
+                }
+
+                // Serve stale data while a single background lookup refreshes it.
+                if (item.valid && !item.ec && now < item.stale)
+                {
+                    if (!item.resolving)
+                    {
+                        item.resolving = true;
+                        asio::co_spawn(io_context, lookup(io_context, key, hostname, service), asio::detached);
+                    }
+
+                    co_return result_type(item.ec, item.endpoints);
+                }
+
+                if (!item.resolving)
+                {
+                    item.resolving = true;
+                    lock.unlock();
+                    co_return co_await lookup(io_context, key, hostname, service);
+                }
+            }
+
+            // Wait for the lookup in progress, which hands its result to every waiter.
+            co_return co_await asio::async_initiate<const asio::use_awaitable_t<>&, void(result_type)>([this, &key] (auto handler)
+            {
+                auto resume = std::make_shared<decltype(handler)>(std::move(handler));
+                std::function<void(const result_type&)> wake = [resume] (const result_type& result)
+                {
+                    auto executor = asio::get_associated_executor(*resume);
+                    asio::post(executor, [resume, result] { std::move(*resume)(result); });
+                };
+
+                std::unique_lock<std::mutex> lock(mutex);
+
+                // Checked again, the lookup may have finished since, and its entry even been cleared.
+                if (auto it = entries.find(key); it == entries.end())
+                {
+                    wake(result_type(asio::error::try_again, endpoints_type()));
+                }
+                else if (it->second.resolving)
+                {
+                    it->second.waiters.emplace_back(std::move(wake));
+                }
+                else
+                {
+                    wake(result_type(it->second.ec, it->second.endpoints));
+                }
+            }, asio::use_awaitable);
+        }
+
+        /**
+         * @brief Drop every cached entry that has no lookup in progress.
+         */
+        void clear()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            std::erase_if(entries, [] (const auto& item) {
+                return !item.second.resolving;
+            });
+        }
+    private:
+        /**
+         * @brief Drop the entries past their stale time, and raise the size at which this is done again.
+         * @param now - The current time.
+         * @note Must be called with the mutex held.
+         */
+        void prune(const clock_type::time_point& now)
+        {
+            std::erase_if(entries, [&] (const auto& item) {
+                return !item.second.resolving && now >= item.second.stale;
+            });
+
+            prune_at = std::max(prune_min, entries.size() * 2);
+        }
+
+        /**
+         * @brief Coroutine performing one lookup and publishing its result to the entry and its waiters.
+         * @param io_context - The context to run the resolver on.
+         * @param key - The cache key of the entry.
+         * @param hostname - The host name to resolve.
+         * @param service - The service name or port number.
+         * @return Returns the result published to the entry.
+         */
+        asio::awaitable<result_type> lookup(asio_context& io_context, std::string key, std::string hostname, std::string service)
+        {
+            asio::error_code ec;
+            endpoints_type endpoints;
+            result_type result;
+            std::vector<std::function<void(const result_type&)>> waiters;
+
+            try
+            {
+                asio_resolver resolver(io_context);
+
+                for (const auto& result : co_await resolver.async_resolve(hostname, service, asio::redirect_error(asio::use_awaitable, ec)))
+                {
+                    endpoints.emplace_back(result.endpoint());
+                }
+            }
+            catch (const std::exception&)
+            {
+                ec = asio::error::host_not_found;
+            }
+
+            if (!ec && endpoints.empty())
+            {
+                ec = asio::error::host_not_found;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                entry& item = entries[key];
+                clock_type::time_point now = clock_type::now();
+
+                // A failed refresh keeps serving the stale endpoints until they run out.
+                if (!ec || !item.valid || item.ec || now >= item.stale)
+                {
+                    item.ec = ec;
+                    item.endpoints = std::move(endpoints);
+                    item.expiry = now + (ec ? negative_ttl : ttl);
+                    item.stale = item.expiry + (ec ? std::chrono::seconds(0) : stale_ttl);
+                    item.valid = true;
+                }
+
+                item.resolving = false;
+                result = result_type(item.ec, item.endpoints);
+                waiters.swap(item.waiters);
+            }
+
+            for (const auto& wake : waiters)
+            {
+                wake(result);
+            }
+
+            co_return result;
+        }
+    private:
+        std::chrono::seconds                                                   ttl;
+        std::chrono::seconds                                                   negative_ttl;
+        std::chrono::seconds                                                   stale_ttl;
+        std::mutex                                                             mutex;
+        std::unordered_map<std::string, entry>                                 entries;
+        static constexpr std::size_t                                           prune_min = 256;
+        std::size_t                                                            prune_at = prune_min;    // map size triggering the next pruning
+    };
+}
+
+#endif // __ASIO_RESOLVER_CACHE_H__
\ No newline at end of file
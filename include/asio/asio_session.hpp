@@ -5,19 +5,315 @@
 #	pragma once
 #endif
 
+#include "asio_compression.hpp"
 #include "asio_context.hpp"
+#include "asio_log.hpp"
+#include "asio_metrics.hpp"
 #include "asio_sleep.hpp"
 #include "asio_observer.hpp"
+#include "asio_rate_limit.hpp"
+#include "asio_socket_profile.hpp"
+#include "asio_trace.hpp"
 #include "asio_utils.hpp"
 
 #include <asio.hpp>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 namespace ik
 {
-    class asio_session : public std::enable_shared_from_this<asio_session>
+    /**
+     * @brief Describes the stream a session runs on, a plain socket unless specialized (TLS streams in `asio_ssl.hpp`).
+     * @tparam Stream - The stream type.
+     * @note A secure stream has a `context_type` shared by its connections and a handshake run before the stream is handed out.
+     */
+    template <typename Stream>
+    struct asio_stream_traits
+    {
+        struct context_type
+        {
+        };
+
+        static constexpr bool secure = false;
+    };
+
+#if defined(__linux__)
+    /**
+     * @brief A region of an open file queued on a session, sent by the kernel without entering user space.
+     * @note The descriptor is duplicated, so the caller may close its own once the region is queued.
+     */
+    struct asio_file_region
+    {
+        explicit asio_file_region(int fd, std::uint64_t offset, std::uint64_t length)
+            : fd(::dup(fd))
+            , offset(offset)
+            , length(length)
+        {
+        }
+        ~asio_file_region()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+
+        asio_file_region(const asio_file_region&) = delete;
+        asio_file_region& operator=(const asio_file_region&) = delete;
+
+        int                                             fd;
+        std::uint64_t                                   offset;
+        std::uint64_t                                   length;
+    };
+#endif
+
+    /**
+     * @brief One entry of a session's outbound queue: a message, or a file region on Linux.
+     */
+    struct asio_outbound
+    {
+        explicit asio_outbound(const std::string_view& data)
+            : data(data)
+        {
+        }
+#if defined(__linux__)
+        explicit asio_outbound(std::shared_ptr<asio_file_region> file)
+            : file(std::move(file))
+        {
+        }
+#endif
+
+        /**
+         * @brief Get the number of bytes the entry puts on the wire, before compression.
+         */
+        std::size_t length() const noexcept
+        {
+#if defined(__linux__)
+            if (file)
+            {
+                return static_cast<std::size_t>(file->length);
+            }
+#endif
+            return data.size();
+        }
+
+        std::string                                     data;
+        std::string                                     key;                                        // set on conflated messages
+#if defined(__linux__)
+        std::shared_ptr<asio_file_region>               file;
+#endif
+    };
+
+    /**
+     * @brief The lane a queued write goes to, lower lanes go out first.
+     */
+    enum class asio_priority : std::size_t
+    {
+        control,                                                                                    // heartbeats, cancels, auth replies
+        normal,
+        bulk,
+        max
+    };
+
+    /**
+     * @brief How the writer picks the lane of the next message.
+     * @note By default a lower lane always goes first, so bulk data only moves while no other message waits. Weighted,
+     *       the lanes take turns by deficit round-robin: every turn a lane may send `weights[lane] * quantum` bytes,
+     *       so a busy control lane cannot starve the bulk lane either.
+     */
+    struct asio_lane_policy
+    {
+        bool                                            weighted = false;
+        std::array<std::size_t, static_cast<std::size_t>(asio_priority::max)> weights{ 16, 4, 1 };
+        std::size_t                                     quantum = 16 * 1024;                        // bytes per turn and weight
+    };
+
+    /**
+     * @brief The outbound queue of a session: one FIFO lane per `asio_priority`, and the scheduler picking between them.
+     * @note Messages of one lane keep their order, messages of different lanes do not. The lane of the next message
+     *       is picked again after every message, so a control message waits for at most the message being sent.
+     *       A keyed message (`conflate`) replaces the unsent message of the same key and lane where it stands, so a lane
+     *       holds at most one waiting message per key, plus the one being sent.
+     */
+    class asio_outbound_queue
+    {
+    public:
+        bool empty() const noexcept
+        {
+            return count == 0;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return count;
+        }
+
+        /**
+         * @brief Queue a message at the back of a lane.
+         */
+        template <typename... Args>
+        asio_outbound& emplace_back(asio_priority priority, Args&&... args)
+        {
+            return count++, lanes[lane(priority)].entries.emplace_back(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Replace the waiting message of `key` in a lane with `data`, or queue it at the back if there is none.
+         * @return Returns `true` if a message was replaced, the queue did not grow then.
+         */
+        bool conflate(asio_priority priority, const std::string_view& key, const std::string_view& data)
+        {
+            lane_state& state = lanes[lane(priority)];
+
+            if (auto it = state.latest.find(std::string(key)); it != state.latest.end())
+            {
+                return it->second->data.assign(data), true;
+            }
+
+            asio_outbound& entry = emplace_back(priority, data);
+            entry.key = key, state.latest.emplace(entry.key, std::addressof(entry));
+            return false;
+        }
+
+        /**
+         * @brief Get the message to send next. It stays the same until `pop_front`, whatever is queued meanwhile.
+         */
+        asio_outbound& front()
+        {
+            return lanes[pick()].entries.front();
+        }
+
+        /**
+         * @brief Get the lane of the message returned by `front`.
+         */
+        asio_priority front_priority()
+        {
+            return static_cast<asio_priority>(pick());
+        }
+
+        /**
+         * @brief Remove the message returned by `front`.
+         */
+        void pop_front()
+        {
+            lanes[pick()].entries.pop_front(), count--, current = lanes.size();
+        }
+
+        void set_policy(const asio_lane_policy& value) noexcept
+        {
+            policy = value;
+        }
+    private:
+        struct lane_state
+        {
+            std::deque<asio_outbound>                   entries;
+            std::unordered_map<std::string, asio_outbound*> latest;                                 // waiting keyed messages, stable as entries only come and go at the ends
+            std::size_t                                 deficit = 0;                                // bytes the lane may still send this turn
+        };
+
+        static std::size_t lane(asio_priority priority) noexcept
+        {
+            return std::min(static_cast<std::size_t>(priority), static_cast<std::size_t>(asio_priority::max) - 1);
+        }
+
+        /**
+         * @brief Pick the lane of the next message, and keep it until that message is popped.
+         */
+        std::size_t pick()
+        {
+            if (current != lanes.size())
+            {
+                return current;
+            }
+
+            if (!policy.weighted)
+            {
+                for (current = 0; lanes[current].entries.empty(); ++current)
+                {
+                }
+
+                return claim(current);
+            }
+
+            // Deficit round-robin: a lane's turn lasts while its credit covers its next message.
+            for (;; turn = (turn + 1) % lanes.size(), fresh = true)
+            {
+                lane_state& state = lanes[turn];
+
+                if (state.entries.empty())
+                {
+                    state.deficit = 0;
+                    continue;
+                }
+
+                if (std::exchange(fresh, false))
+                {
+                    state.deficit += std::max<std::size_t>(policy.weights[turn], 1) * std::max<std::size_t>(policy.quantum, 1);
+                }
+
+                if (state.deficit >= state.entries.front().length())
+                {
+                    return claim(current = turn);
+                }
+            }
+        }
+
+        /**
+         * @brief Take the front message of a picked lane out of conflation and charge it to the lane's credit, its
+         *        buffer is about to be sent.
+         * @note Any key is looked up, the empty one included, so the index never outlives the entry it points to.
+         *       The charge is taken here as the sender may move the buffer out before `pop_front`, as zero-copy does.
+         */
+        std::size_t claim(std::size_t idx)
+        {
+            lane_state& state = lanes[idx];
+
+            if (asio_outbound& entry = state.entries.front(); !state.latest.empty())
+            {
+                if (auto it = state.latest.find(entry.key); it != state.latest.end() && it->second == std::addressof(entry))
+                {
+                    state.latest.erase(it);
+                }
+            }
+
+            state.deficit -= std::min(state.deficit, state.entries.front().length());
+            return idx;
+        }
+    private:
+        std::array<lane_state, static_cast<std::size_t>(asio_priority::max)> lanes;
+        asio_lane_policy                                policy;
+        std::size_t                                     count = 0;
+        std::size_t                                     current = static_cast<std::size_t>(asio_priority::max);   // the lane picked for `front`, or none
+        std::size_t                                     turn = 0;
+        bool                                            fresh = true;                               // `turn` has not been credited yet
+    };
+
+    /**
+     * @brief A connected stream socket with a reader and a queued writer, for any stream protocol.
+     * @tparam Protocol - The stream protocol, e.g. `asio::ip::tcp` (`asio_session`) or `asio::local::stream_protocol` (`asio_local_session`).
+     * @tparam Stream - The stream read and written, the protocol's socket or a TLS stream over it (`asio_ssl_session`).
+     * @note Handlers receive the session as `asio_stream_session<Protocol, Stream>&`, so a binder serves one kind of session.
+     */
+    template <typename Protocol, typename Stream = typename Protocol::socket>
+    class asio_stream_session : public std::enable_shared_from_this<asio_stream_session<Protocol, Stream>>
     {
     public:
-        explicit asio_session(asio_context& io_context, asio_binder& binder, asio_socket& stream_socket, std::size_t id)
+        using protocol_type = Protocol;
+        using socket_type = Stream;
+        using endpoint_type = typename Protocol::endpoint;
+    public:
+        explicit asio_stream_session(asio_context& io_context, asio_binder& binder, socket_type& stream_socket, std::size_t id)
             : self(std::ref(*this))
             , io_context(io_context)
             , io_strand(io_context.get_executor())
@@ -25,10 +321,11 @@ namespace ik
             , stream_socket(std::move(stream_socket))
             , id(id)
             , sleep(std::make_shared<asio_sleep>(io_context))
+            , io_greeted(false)
         {
             // transfer the initialization action to avoid not being able to use shared_from_this() directly in the constructor
         }
-        explicit asio_session(asio_session&& other) noexcept
+        explicit asio_stream_session(asio_stream_session&& other) noexcept
             : self(std::ref(*this))
             , io_context(other.io_context)
             , io_strand(std::move(other.io_strand))
@@ -37,16 +334,29 @@ namespace ik
             , id(other.id)
             , sleep(std::move(other.sleep))
             , io_msdeque(std::move(other.io_msdeque))
+            , io_codec(std::move(other.io_codec))
+            , io_frame(std::move(other.io_frame))
+            , io_greeted(other.io_greeted)
             , remote(std::move(other.remote))
             , local(std::move(other.local))
+            , rate(other.rate)
+#if defined(SO_ZEROCOPY)
+            , zerocopy(std::move(other.zerocopy))
+#endif
+#if defined(TCP_CORK)
+            , cork(other.cork)
+#endif
         {
         }
-        virtual ~asio_session()
+        virtual ~asio_stream_session()
         {
-
+            if (!io_msdeque.empty())
+            {
+                io_context.get_metrics().add(metric_type::queue_depth, -static_cast<std::int64_t>(io_msdeque.size()));
+            }
         };
     public:
-        asio_session& init()
+        asio_stream_session& init()
         {
             io_context.dispatch([&]
             {
@@ -57,6 +367,7 @@ namespace ik
                     // as memory deallocation must consider the lifecycle of the coroutine.
                     asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->reader(); }, asio::bind_executor(io_strand, asio::detached));
                     asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->writer(); }, asio::bind_executor(io_strand, asio::detached));
+                    io_context.get_metrics().add(metric_type::sessions);
                 }
                 catch (const std::exception&)
                 {
@@ -76,11 +387,18 @@ namespace ik
          * @param buffer - The data to be sent as a string.
          * @note If the function is called from within the `io_context` thread, it directly spawns a coroutine to send the data.
          *       Otherwise, it posts the task to the `io_context` to be executed later.
+         *       With compression the message is queued like `async_writer` instead, so its frame is written whole, in
+         *       order with the writer's frames, and `bind_type::writer` is notified rather than `bind_type::send`.
          */
-        asio_session& async_send(const std::string_view& buffer)
+        asio_stream_session& async_send(const std::string_view& buffer)
         {
+            if (io_codec)
+            {
+                return async_writer(buffer);
+            }
+
             asio::co_spawn(io_context,
-                           async_send_coro(buffer),
+                           async_send_coro(std::string(buffer)),
                            asio::bind_executor(io_strand, asio::detached));
             return *this;
         }
@@ -88,32 +406,260 @@ namespace ik
         /**
          * @brief Asynchronously write data to the socket.
          * @param buffer - The data to be written as a string.
+         * @param priority - The lane of the message, see `set_lanes`. Messages of one lane go out in order.
          * @note If the function is called from within the `io_context` thread and the socket is open,
          *       the data is added to the message queue and a sleep timer is canceled to trigger immediate processing.
          *       Otherwise, it posts the task to the `io_context` to be executed later.
+         *       The data is copied into the queue, so `buffer` only has to stay valid for the duration of the call.
+         */
+        asio_stream_session& async_writer(const std::string_view& buffer, asio_priority priority = asio_priority::normal)
+        {
+            if (io_context.running_in_this_thread())
+            {
+                if (stream_socket.lowest_layer().is_open())
+                {
+                    io_msdeque.emplace_back(priority, buffer);
+                    count(metric_type::queue_depth);
+                    ASIO_TRACE(enqueue, id, buffer.size());
+                    sleep->cancel_one();
+                }
+            }
+            else
+            {
+                io_context.dispatch([this, data = std::string(buffer), priority] { this->async_writer(data, priority); });
+            }
+
+            return *this;
+        }
+
+#if defined(__linux__)
+        /**
+         * @brief Queue a region of a file, sent in order with the messages of `async_writer` without being copied to user space.
+         * @param fd - An open file, duplicated here so the caller may close it once this returns.
+         * @param offset - The offset of the region in the file.
+         * @param length - The length of the region.
+         * @param priority - The lane of the region, see `set_lanes`.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note The region is sent with `sendfile`, which TLS streams cannot use. A compressed session, or a file
+         *       `sendfile` does not support, reads the region through a buffer instead, a compressed session as one message.
+         *       `bind_type::writer` is notified with the number of bytes sent once the region is out.
+         */
+        asio_stream_session& async_sendfile(int fd, std::uint64_t offset, std::uint64_t length, asio_priority priority = asio_priority::normal) requires (!asio_stream_traits<Stream>::secure)
+        {
+            std::shared_ptr<asio_file_region> region = std::make_shared<asio_file_region>(fd, offset, length);
+
+            if (region->fd < 0)
+            {
+                io_context.get_metrics().error(asio_error(errno, asio::error::get_system_category()));
+                return *this;
+            }
+
+            io_context.dispatch([this, region, priority]
+            {
+                if (stream_socket.lowest_layer().is_open())
+                {
+                    io_msdeque.emplace_back(priority, region);
+                    count(metric_type::queue_depth);
+                    ASIO_TRACE(enqueue, id, region->length);
+                    sleep->cancel_one();
+                }
+            });
+
+            return *this;
+        }
+#endif
+
+        /**
+         * @brief Frame and compress this session's messages, before `init`.
+         * @param options - The compression settings, possibly shared with other sessions.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note The peer must enable it as well. Each `async_writer`/`async_send` call then becomes one message,
+         *       and `bind_type::recv` is notified once per whole message, decompressed, instead of once per read.
+         *       A message larger than `asio_frame_codec::max_frame` is not sent, `bind_type::writer` is notified with
+         *       `asio::error::message_size` for it and the connection goes on.
+         */
+        asio_stream_session& set_compression(std::shared_ptr<const asio_compression> options)
+        {
+            io_codec = options ? std::make_unique<asio_frame_codec>(std::move(options)) : nullptr;
+            return *this;
+        }
+
+#if defined(SO_ZEROCOPY)
+        /**
+         * @brief Send large messages with `MSG_ZEROCOPY`, the kernel then reads them from the queue's own buffer.
+         * @param threshold - The size from which a message is sent without copying, `0` to turn it off.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note Only for uncompressed TCP sessions on Linux, other sessions keep the normal path. A message's buffer is
+         *       held until the kernel reports the send complete on the socket's error queue. If the kernel reports
+         *       it had to copy the data anyway (e.g. over loopback), zero-copy is turned off for the session again.
+         */
+        asio_stream_session& set_zerocopy(std::size_t threshold) requires (!asio_stream_traits<Stream>::secure)
+        {
+            int enable = threshold != 0 ? 1 : 0;
+
+            if (::setsockopt(stream_socket.lowest_layer().native_handle(), SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == 0)
+            {
+                zerocopy.threshold = threshold;
+            }
+            else
+            {
+                zerocopy.threshold = 0;
+                ASIO_LOG_DEBUG("session %zu: SO_ZEROCOPY not supported (%d)", id, errno);
+            }
+
+            return *this;
+        }
+#endif
+
+        /**
+         * @brief Take the per-session part of a socket profile, before `init`.
+         * @param profile - The profile, usually the one of the server or client the socket came from.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note With `adaptive_cork` on a TCP session on Linux, the writer sets `TCP_CORK` once more than one message is
+         *       queued, so a burst leaves in full segments, and clears it when the queue is flushed, which pushes out the
+         *       tail at once. A server applies its profile to the sessions it accepts, a client's sessions take it here.
+         */
+        asio_stream_session& set_profile(const asio_socket_profile& profile)
+        {
+#if defined(TCP_CORK)
+            if constexpr (std::is_same_v<Protocol, asio::ip::tcp>)
+            {
+                cork.adaptive = profile.adaptive_cork;
+            }
+#endif
+            return *this;
+        }
+
+        /**
+         * @brief Queue the latest value of `key`, replacing the value of the same key still waiting to be sent.
+         * @param key - The key, e.g. an instrument. Values of different keys are kept apart.
+         * @param buffer - The value, copied into the queue.
+         * @param priority - The lane, keys are conflated within a lane.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note The replaced value keeps its place in the queue, so a slow reader gets the current value of each key
+         *       as soon as it catches up instead of every stale one, and the queue holds at most one value per key.
+         *       A value already being written is not touched, the new one is queued behind it.
+         *       Replacements are counted in `metric_type::conflated`.
+         */
+        asio_stream_session& async_conflate(const std::string_view& key, const std::string_view& buffer, asio_priority priority = asio_priority::normal)
+        {
+            if (io_context.running_in_this_thread())
+            {
+                if (!stream_socket.lowest_layer().is_open())
+                {
+                    return *this;
+                }
+
+                if (io_msdeque.conflate(priority, key, buffer))
+                {
+                    io_context.get_metrics().add(metric_type::conflated);
+                }
+                else
+                {
+                    count(metric_type::queue_depth);
+                    ASIO_TRACE(enqueue, id, buffer.size());
+                    sleep->cancel_one();
+                }
+            }
+            else
+            {
+                io_context.dispatch([this, key = std::string(key), data = std::string(buffer), priority] { this->async_conflate(key, data, priority); });
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Choose how the writer shares the connection between the lanes of `asio_priority`, before `init`.
+         * @param policy - Strict priority by default, or weighted round-robin.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note The writer picks the lane again after every message, so a large transfer queued as a series of frames
+         *       (e.g. `async_sendfile` regions of a few hundred kilobytes) lets control messages through between them.
+         *       A single message is never split, the stream would lose its framing. With adaptive corking, the segment
+         *       holding a control message is pushed out at once.
+         */
+        asio_stream_session& set_lanes(const asio_lane_policy& policy)
+        {
+            io_msdeque.set_policy(policy);
+            return *this;
+        }
+
+        /**
+         * @brief Limit the rates of this session, before `init` or on the session's context.
+         * @param limit - The rates, a default `asio_rate_limit` removes the limits.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note Nothing is dropped: past its inbound rates the reader pauses, which leaves the data in the socket buffer
+         *       and lets TCP push back on the peer, and past its outbound rate the writer holds the queue. The budget of
+         *       the context (`asio_context::get_limiter`) is charged as well, the longer of both waits applies.
+         *       Paused sessions are woken by the context's clock, so they hold no timer of their own.
+         */
+        asio_stream_session& set_rate_limit(const asio_rate_limit& limit)
+        {
+            rate.configure(limit);
+            return *this;
+        }
+
+        /**
+         * @brief Move the session to another context, with its socket, queued writes and compression state.
+         * @param target - The context to move to, e.g. from the server's `get_group()` or `asio_affinity`.
+         * @return Returns a reference to the current `asio_stream_session` object to support chaining.
+         * @note Only for an initialized session on a plain socket, TLS streams cannot change context. The writer hands
+         *       over between two messages, once the reader delivered what it had read and stopped: the socket is
+         *       released and adopted by a new session on `target`, notified there through `bind_type::migrate` in place
+         *       of this one, which then ends without a disconnect. Writes queued on this session up to the handover go
+         *       with it, later ones are dropped, so switch to the new session in the handler. Do not migrate while an
+         *       `async_send` is in flight. Without a `bind_type::migrate` observer nobody could take the new session
+         *       over, so the call is ignored and the session stays where it is.
          */
-        asio_session& async_writer(const std::string_view& buffer)
+        asio_stream_session& migrate(asio_context& target) requires (!asio_stream_traits<Stream>::secure)
         {
             if (io_context.running_in_this_thread())
             {
-                if (stream_socket.is_open())
+                if (std::addressof(target) != std::addressof(io_context) && migration.target == nullptr && stream_socket.is_open() && binder.has(bind_type::migrate))
                 {
-                    io_msdeque.push_back(buffer);
+                    migration.target = std::addressof(target);
                     sleep->cancel_one();
                 }
             }
             else
             {
-                io_context.dispatch([&] { this->async_writer(buffer); });
+                io_context.dispatch([this, &target] { this->migrate(target); });
             }
 
             return *this;
         }
 
+        /**
+         * @brief Get the context this session runs on.
+         */
+        asio_context& get_context() noexcept
+        {
+            return io_context;
+        }
+
         std::size_t index() const
         {
             return id;
         }
+
+        /**
+         * @brief Get the counters of this session.
+         * @return Returns the bytes and messages in and out and the number of queued writes of this session.
+         * @note The same counters are also added to the metrics of the session's context.
+         */
+        const asio_session_metrics& get_metrics() const noexcept
+        {
+            return metrics;
+        }
+
+        /**
+         * @brief Check if the underlying socket is still open.
+         * @return Returns `true` if the socket is open, otherwise `false`.
+         */
+        bool is_open() const
+        {
+            return stream_socket.lowest_layer().is_open();
+        }
         /**
         * @brief Close the socket and clean up resources.
         * @note If the function is called from within the `io_context` thread, it directly closes the socket and cancels the sleep timer.
@@ -127,10 +673,18 @@ namespace ik
             {
                 if (io_context.running_in_this_thread())
                 {
-                    if (sleep->cancel() && stream_socket.is_open())
+                    if (sleep->cancel() && stream_socket.lowest_layer().is_open())
                     {
-                        stream_socket.shutdown(asio::socket_base::shutdown_both, ec);
-                        stream_socket.close(ec);
+                        ASIO_TRACE(close, id, 0);
+                        io_context.get_limiter().cancel(this);
+
+                        if constexpr (asio_stream_traits<Stream>::secure)
+                        {
+                            asio_stream_traits<Stream>::shutdown(stream_socket);
+                        }
+
+                        stream_socket.lowest_layer().shutdown(asio::socket_base::shutdown_both, ec);
+                        stream_socket.lowest_layer().close(ec);
                     }
                 }
                 else
@@ -148,7 +702,7 @@ namespace ik
         {
             try
             {
-                io_context.post(std::bind(&asio_session::close, this));
+                io_context.post(std::bind(&asio_stream_session::close, this));
             }
             catch (const std::exception&)
             {
@@ -158,24 +712,29 @@ namespace ik
 
         /**
          * @brief Coroutine to asynchronously send data through the socket.
-         * @param buffer - The data to be sent as a string.
+         * @param buffer - The data to be sent, owned by the coroutine frame until the send completes.
          * @note This coroutine sends the data and closes the socket if an error occurs.
          */
-        asio::awaitable<void> async_send_coro(const std::string_view& buffer)
+        asio::awaitable<void> async_send_coro(std::string buffer)
         {
             asio::error_code ec;
             size_t n = 0;
 
             try
             {
-                if (stream_socket.is_open())
+                if (stream_socket.lowest_layer().is_open())
                 {
-                    if ((n = co_await stream_socket.async_send(
+                    if ((n = co_await stream_socket.async_write_some(
                         asio::buffer(buffer.data(), buffer.size()),
                         asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)))) < 0 || ec)
                     {
+                        fault(ec);
                         this->close();
                     }
+                    else
+                    {
+                        count(metric_type::bytes_out, n), count(metric_type::messages_out);
+                    }
 
                     co_await binder.async_notify(bind_type::send, io_context, self, n, ec);
                 }
@@ -197,21 +756,64 @@ namespace ik
 
             try
             {
-                for (size_t n = 0; stream_socket.is_open();  asio::co_spawn(io_context.get_parent().get_executor(), [&] () -> asio::awaitable<void> {
-                    co_await binder.async_notify(bind_type::disconnect, io_context, self, ec);
-                }, asio::detached))
+                for (size_t n = 0; stream_socket.lowest_layer().is_open(); disconnected(ec))
                 {
-                    for (;; co_await binder.async_notify(bind_type::recv, io_context, self, std::ref(data), n))
+                    // The awaits sit at the end of the loop bodies rather than in the increments, which GCC 12 rejects in templates.
+                    for (;;)
                     {
-                        if ((n = co_await stream_socket.async_read_some(asio::buffer(std::ref(data), sizeof(data)),
+                        // A migration waits for the reader to stop between two reads, then the new session reads on.
+                        if (migration.target != nullptr)
+                        {
+                            migration.parked = true, sleep->cancel_one();
+                            co_return;
+                        }
+
+                        if ((n = co_await stream_socket.async_read_some(asio::buffer(std::ref(data), sizeof(data)),
                                                                         asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)))) == 0 || ec)
                         {
+                            if (migration.target != nullptr)
+                            {
+                                migration.parked = true, sleep->cancel_one();
+                                co_return;
+                            }
+
                             if (ec)
                             {
+                                fault(ec);
                                 this->close();
                                 break;
                             }
                         }
+                        else
+                        {
+                            count(metric_type::bytes_in, n), count(metric_type::messages_in);
+                            ASIO_TRACE(read, id, n);
+
+                            // Over its rate the reader pauses before it delivers and reads on, the peer then fills the socket buffers.
+                            if (rate.limited() || io_context.get_limiter().limited())
+                            {
+                                asio_rate_clock::time_point now = asio_rate_clock::now();
+
+                                if (co_await throttle(std::max(rate.inbound(n, 1, now), io_context.get_limiter().inbound(n, 1, now))), !stream_socket.lowest_layer().is_open())
+                                {
+                                    break;
+                                }
+                            }
+                        }
+
+                        if (io_codec)
+                        {
+                            if (ec = io_codec->decode(data, n, [this] (const char* buf, std::size_t len) { binder.notify(bind_type::recv, io_context, self, buf, len); }), ec)
+                            {
+                                fault(ec);
+                                this->close();
+                                break;
+                            }
+
+                            continue;
+                        }
+
+                        co_await binder.async_notify(bind_type::recv, io_context, self, std::ref(data), n);
                     }
                 }
             }
@@ -232,42 +834,577 @@ namespace ik
 
             try
             {
-                for (; stream_socket.is_open(); co_await sleep->async_wait(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration::max()), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))))
+                // With compression the peer learns our codecs from the hello frame, which goes out first, once per connection.
+                if (io_codec && !std::exchange(io_greeted, true))
+                {
+                    io_frame.clear(), io_codec->hello(io_frame);
+
+                    if (co_await asio::async_write(stream_socket, asio::buffer(io_frame), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                    {
+                        fault(ec);
+                        this->close();
+                        co_return;
+                    }
+                }
+
+#if defined(SO_ZEROCOPY)
+                // Buffers of a migrated session may still be held by the kernel.
+                if (!zerocopy.pending.empty() && !std::exchange(zerocopy.reaping, true))
+                {
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->zerocopy_reaper(); }, asio::bind_executor(io_strand, asio::detached));
+                }
+#endif
+
+                for (; stream_socket.lowest_layer().is_open(); )
                 {
                     for (size_t n = 0; !io_msdeque.empty();)
                     {
-                        if ((n = co_await stream_socket.async_send(asio::buffer(io_msdeque.front()),
-                                                                   asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)))) == 0 && ec)
+                        if (migration.target != nullptr && handoff())
                         {
+                            co_return;
+                        }
+
+                        // The message is charged before it goes out, over the rate the writer holds it back.
+                        if (rate.limited() || io_context.get_limiter().limited())
+                        {
+                            asio_rate_clock::time_point now = asio_rate_clock::now();
+                            std::size_t size = io_msdeque.front().length();
+
+                            if (co_await throttle(std::max(rate.outbound(size, now), io_context.get_limiter().outbound(size, now))), !stream_socket.lowest_layer().is_open())
+                            {
+                                co_return;
+                            }
+                        }
+
+#if defined(TCP_CORK)
+                        if (cork.adaptive && !cork.corked && io_msdeque.size() > 1)
+                        {
+                            cork.corked = set_cork(true);
+                        }
+#endif
+#if defined(__linux__)
+                        if (io_msdeque.front().file)
+                        {
+                            n = co_await send_file(*io_msdeque.front().file, ec);
+                        }
+                        else
+#endif
+#if defined(SO_ZEROCOPY)
+                        if (zerocopy.threshold != 0 && !io_codec && io_msdeque.front().data.size() >= zerocopy.threshold)
+                        {
+                            n = co_await send_zerocopy(io_msdeque.front().data, ec);
+                        }
+                        else
+#endif
+                        {
+                            asio::const_buffer buffer = asio::buffer(io_msdeque.front().data);
+
+                            if (io_codec)
+                            {
+                                io_frame.clear(), ec = io_codec->encode(io_msdeque.front().data, io_frame);
+                                buffer = asio::buffer(io_frame);
+                            }
+
+                            // async_write keeps sending until the whole message is out, a single send may be partial.
+                            if (n = 0; !io_codec || !ec)
+                            {
+                                n = co_await asio::async_write(stream_socket, buffer, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                            }
+                        }
+
+                        if (ec == asio::error::message_size)
+                        {
+                            // Too large for one frame, the peer would drop the connection. Only the message is dropped, and reported.
+                            fault(ec);
+                            io_msdeque.pop_front();
+                            count(metric_type::queue_depth, -1);
+                            co_await binder.async_notify(bind_type::writer, io_context, self, n, ec);
+                            continue;
+                        }
+                        else if (ec)
+                        {
+                            fault(ec);
                             this->close();
                             co_return;
                         }
                         else
                         {
+#if defined(TCP_CORK)
+                            // A control message does not wait in a corked partial segment for the bulk data behind it.
+                            if (cork.corked && io_msdeque.front_priority() == asio_priority::control)
+                            {
+                                cork.corked = false, set_cork(false);
+                            }
+#endif
                             io_msdeque.pop_front();
+                            count(metric_type::queue_depth, -1), count(metric_type::bytes_out, n), count(metric_type::messages_out);
+                            ASIO_TRACE(write, id, n);
                         }
 
                         co_await binder.async_notify(bind_type::writer, io_context, self, n, ec);
                     }
+
+#if defined(TCP_CORK)
+                    // The queue is flushed, uncorking sends the partial segment left behind without waiting for more.
+                    if (cork.corked)
+                    {
+                        cork.corked = false, set_cork(false);
+                    }
+#endif
+
+                    if (migration.target != nullptr && handoff())
+                    {
+                        co_return;
+                    }
+
+                    co_await sleep->async_wait(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration::max()), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
                 }
             }
             catch (std::exception& ex)
             {
-                printf("%s\n", ex.what());
+                ASIO_LOG_ERROR("%s", ex.what());
+            }
+        }
+
+#if defined(SO_ZEROCOPY)
+        /**
+         * @brief Coroutine sending a message with `MSG_ZEROCOPY`, then parking its buffer until the kernel is done with it.
+         * @param data - The message, moved out of the queue entry once sent.
+         * @param ec - Set to the error that stopped the send.
+         * @return Returns the number of bytes sent.
+         */
+        asio::awaitable<std::size_t> send_zerocopy(std::string& data, asio_error& ec)
+        {
+            std::size_t n = 0;
+            int fd = stream_socket.lowest_layer().native_handle();
+
+            if (stream_socket.lowest_layer().native_non_blocking(true, ec), ec)
+            {
+                co_return n;
+            }
+
+            for (ssize_t k = 0; n < data.size(); )
+            {
+                if ((k = ::send(fd, data.data() + n, data.size() - n, MSG_ZEROCOPY | MSG_NOSIGNAL)) >= 0)
+                {
+                    n += static_cast<std::size_t>(k), zerocopy.sent++;
+                }
+                else if (errno == EAGAIN)
+                {
+                    reap_zerocopy();
+
+                    if (co_await stream_socket.lowest_layer().async_wait(asio::socket_base::wait_write, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                    {
+                        break;
+                    }
+                }
+                else if (errno == ENOBUFS)
+                {
+                    // Out of option memory for notifications, send the rest with a copy.
+                    n += co_await asio::async_write(stream_socket, asio::buffer(data.data() + n, data.size() - n), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                    break;
+                }
+                else if (errno != EINTR)
+                {
+                    ec = asio_error(errno, asio::error::get_system_category());
+                    break;
+                }
+            }
+
+            if (std::uint32_t end = zerocopy.sent; static_cast<std::int32_t>(end - zerocopy.done) > 0)
+            {
+                zerocopy.pending.emplace_back(end, std::move(data));
+                reap_zerocopy();
+
+                if (!zerocopy.pending.empty() && !std::exchange(zerocopy.reaping, true))
+                {
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->zerocopy_reaper(); }, asio::bind_executor(io_strand, asio::detached));
+                }
+            }
+
+            co_return n;
+        }
+
+        /**
+         * @brief Coroutine waiting for zero-copy completions while buffers are held.
+         */
+        asio::awaitable<void> zerocopy_reaper()
+        {
+            asio::error_code ec;
+
+            try
+            {
+                for (; !zerocopy.pending.empty() && stream_socket.lowest_layer().is_open(); )
+                {
+                    if (co_await stream_socket.lowest_layer().async_wait(asio::socket_base::wait_error, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                    {
+                        break;
+                    }
+
+                    reap_zerocopy();
+                }
+            }
+            catch (const std::exception&)
+            {
+                // Exception handling (e.g., logging) can be added here.
+            }
+
+            zerocopy.reaping = false;
+        }
+
+        /**
+         * @brief Read the completions queued on the socket's error queue and release the buffers they cover.
+         */
+        void reap_zerocopy() noexcept
+        {
+            alignas(cmsghdr) char control[128];
+
+            for (;;)
+            {
+                msghdr msg{};
+                msg.msg_control = control, msg.msg_controllen = sizeof(control);
+
+                if (::recvmsg(stream_socket.lowest_layer().native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                {
+                    break;
+                }
+
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+                {
+                    const sock_extended_err* err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+
+                    if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    {
+                        continue;
+                    }
+
+                    // Completions cover the inclusive range [ee_info, ee_data] of send calls, TCP completes them in order.
+                    if (static_cast<std::int32_t>(err->ee_data + 1 - zerocopy.done) > 0)
+                    {
+                        zerocopy.done = err->ee_data + 1;
+                    }
+
+                    if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    {
+                        zerocopy.threshold = 0;
+                    }
+                }
+            }
+
+            for (; !zerocopy.pending.empty() && static_cast<std::int32_t>(zerocopy.done - zerocopy.pending.front().first) >= 0; )
+            {
+                zerocopy.pending.pop_front();
+            }
+        }
+#endif
+
+#if defined(__linux__)
+        /**
+         * @brief Coroutine sending a file region with `sendfile`, waiting for the socket to drain whenever it is full.
+         * @param region - The region to send.
+         * @param ec - Set to the error that stopped the transfer, `asio::error::eof` if the file is shorter than the region,
+         *        `asio::error::message_size` if a compressed session's region is larger than one frame may be.
+         * @return Returns the number of bytes sent.
+         */
+        asio::awaitable<std::size_t> send_file(asio_file_region& region, asio_error& ec)
+        {
+            std::size_t n = 0;
+            off_t offset = static_cast<off_t>(region.offset);
+
+            if (!io_codec && (stream_socket.lowest_layer().native_non_blocking(true, ec), !ec))
+            {
+                for (ssize_t k = 0; n < region.length; )
+                {
+                    if ((k = ::sendfile(stream_socket.lowest_layer().native_handle(), region.fd, &offset, static_cast<std::size_t>(std::min<std::uint64_t>(region.length - n, 1u << 30)))) > 0)
+                    {
+                        n += static_cast<std::size_t>(k);
+                    }
+                    else if (k == 0)
+                    {
+                        ec = asio::error::eof;
+                        co_return n;
+                    }
+                    else if (errno == EAGAIN)
+                    {
+                        if (co_await stream_socket.lowest_layer().async_wait(asio::socket_base::wait_write, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                        {
+                            co_return n;
+                        }
+                    }
+                    else if (errno == EINVAL || errno == ENOSYS)
+                    {
+                        break;
+                    }
+                    else if (errno != EINTR)
+                    {
+                        ec = asio_error(errno, asio::error::get_system_category());
+                        co_return n;
+                    }
+                }
+
+                if (n == region.length)
+                {
+                    co_return n;
+                }
+            }
+
+            // A compressed session frames the region as one message, other sessions copy it in chunks.
+            for (std::string chunk; n < region.length && !ec; )
+            {
+                std::size_t size = io_codec ? static_cast<std::size_t>(region.length - n) : static_cast<std::size_t>(std::min<std::uint64_t>(region.length - n, 64 * 1024));
+
+                if (io_codec && region.length > asio_frame_codec::max_frame)
+                {
+                    ec = asio::error::message_size;
+                    break;
+                }
+
+                ssize_t k = ::pread(region.fd, (chunk.resize(size), chunk.data()), size, offset);
+
+                if (k < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (k <= 0 || (io_codec && static_cast<std::size_t>(k) != size))
+                {
+                    ec = k < 0 ? asio_error(errno, asio::error::get_system_category()) : asio_error(asio::error::eof);
+                    break;
+                }
+
+                chunk.resize(size = static_cast<std::size_t>(k));
+
+                if (io_codec)
+                {
+                    if (io_frame.clear(), ec = io_codec->encode(chunk, io_frame); ec)
+                    {
+                        break;
+                    }
+
+                    co_await asio::async_write(stream_socket, asio::buffer(io_frame), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                }
+                else
+                {
+                    co_await asio::async_write(stream_socket, asio::buffer(chunk), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                }
+
+                n += size, offset += static_cast<off_t>(size);
+            }
+
+            co_return n;
+        }
+#endif
+        /**
+         * @brief Hand the socket and the session state over to a new session on `migration.target`, between two messages.
+         * @return Returns `true` if the session moved, this one then has no socket left. Until the reader stopped, this
+         *         cancels its read and returns `false`, the reader wakes the writer again once it stopped. If the socket
+         *         cannot be released (e.g. on older Windows), or nobody observes `bind_type::migrate` anymore, it stays here,
+         *         the migration is dropped and the reader restarts.
+         */
+        bool handoff()
+        {
+            asio_error ec;
+
+            if constexpr (asio_stream_traits<Stream>::secure)
+            {
+                return migration = {}, false;
+            }
+            else if (!migration.parked)
+            {
+                if (!std::exchange(migration.cancelled, true))
+                {
+                    stream_socket.cancel(ec);
+                }
+
+                return false;
+            }
+            else
+            {
+                asio_context& target = *migration.target;
+                typename Protocol::socket socket(target);
+                Protocol protocol = stream_socket.local_endpoint(ec).protocol();
+
+                if (!binder.has(bind_type::migrate))
+                {
+                    ASIO_LOG_WARN("session %zu: cannot migrate, no migrate observer", id);
+                    migration = {};
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->reader(); }, asio::bind_executor(io_strand, asio::detached));
+                    return false;
+                }
+                else if (auto handle = stream_socket.release(ec); ec)
+                {
+                    ASIO_LOG_WARN("session %zu: cannot migrate, %s", id, ec.message().c_str());
+                    migration = {};
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->reader(); }, asio::bind_executor(io_strand, asio::detached));
+                    return false;
+                }
+                else if (socket.assign(protocol, handle, ec), ec)
+                {
+                    // The descriptor is ours alone now and the reader has stopped, close it and end the session here.
+                    fault(ec);
+                    Stream(io_context, protocol, handle).close(ec);
+                    migration = {};
+                    disconnected(ec);
+                    return true;
+                }
+
+                std::int64_t depth = static_cast<std::int64_t>(io_msdeque.size());
+                asio_stream_session session(target, binder, socket, id);
+
+                session.io_msdeque = std::exchange(io_msdeque, {});
+                session.io_codec = std::move(io_codec);
+                session.io_greeted = io_greeted;
+                session.remote = remote, session.local = local;
+                session.rate = rate;
+#if defined(SO_ZEROCOPY)
+                session.zerocopy = std::exchange(zerocopy, {});
+                session.zerocopy.reaping = false;
+#endif
+#if defined(TCP_CORK)
+                session.cork = cork;
+#endif
+                for (std::size_t i = 0; i < asio_session_metrics::counter_cnt; ++i)
+                {
+                    session.metrics.add(static_cast<metric_type>(i), metrics.get(static_cast<metric_type>(i)));
+                }
+
+                io_context.get_metrics().add(metric_type::sessions, -1);
+                io_context.get_metrics().add(metric_type::queue_depth, -depth);
+                target.get_metrics().add(metric_type::queue_depth, depth);
+                target.get_metrics().add(metric_type::migrations);
+
+                asio::co_spawn(target, [&binder = binder, &target, session = std::make_shared<asio_stream_session>(std::move(session))] () -> asio::awaitable<void>
+                {
+                    asio_error ec;
+                    co_await binder.async_notify(bind_type::migrate, target, *session, ec);
+                }, asio::detached);
+
+                return true;
+            }
+        }
+
+        /**
+         * @brief Count the session out and notify `bind_type::disconnect` with `ec`.
+         * @note The notification outlives the caller, so it keeps the session alive and takes its own copy of the error.
+         */
+        void disconnected(const asio_error& ec)
+        {
+            io_context.get_metrics().add(metric_type::disconnects), io_context.get_metrics().add(metric_type::sessions, -1);
+
+            asio::co_spawn(io_context.get_parent().get_executor(), [this, ptr = this->shared_from_this(), ec] () mutable -> asio::awaitable<void> {
+                co_await binder.async_notify(bind_type::disconnect, io_context, self, ec);
+            }, asio::detached);
+        }
+
+        /**
+         * @brief Coroutine pausing the reader or the writer on the context's clock.
+         * @param delay - The time to pause, nothing happens if it is zero. `close` ends the pause early.
+         */
+        asio::awaitable<void> throttle(const asio_rate_clock::duration& delay)
+        {
+            asio_error ec;
+
+            if (delay > asio_rate_clock::duration::zero())
+            {
+                io_context.get_metrics().add(metric_type::throttled);
+                co_await io_context.get_limiter().async_wait(this, asio_rate_clock::now() + delay, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+            }
+        }
+
+#if defined(TCP_CORK)
+        /**
+         * @brief Set or clear `TCP_CORK`, holding back partial segments while it is set.
+         * @return Returns `true` if the option was changed.
+         */
+        bool set_cork(bool enable) noexcept
+        {
+            int value = enable ? 1 : 0;
+            return ::setsockopt(stream_socket.lowest_layer().native_handle(), IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0;
+        }
+#endif
+    private:
+        /**
+         * @brief Add to a counter of both this session and its context.
+         */
+        void count(metric_type type, std::int64_t n = 1) noexcept
+        {
+            io_context.get_metrics().add(type, n);
+            metrics.add(type, n);
+        }
+
+        /**
+         * @brief Count an I/O error on the context, a peer closing or the session closing itself is not an error.
+         */
+        void fault(const asio_error& ec) noexcept
+        {
+            if constexpr (asio_stream_traits<Stream>::secure)
+            {
+                if (asio_stream_traits<Stream>::truncated(ec))
+                {
+                    return;
+                }
+            }
+
+            if (ec != asio::error::eof && ec != asio::error::operation_aborted)
+            {
+                io_context.get_metrics().error(ec);
             }
         }
     private:
-        asio_session&                                  self;
+        asio_stream_session&                           self;
         asio_context&                                  io_context;
         asio::strand<asio::io_context::executor_type>  io_strand;
         asio_binder&                                   binder;
-        asio_socket                                    stream_socket;
+        socket_type                                    stream_socket;
         std::size_t                                    id;
         std::shared_ptr<asio_sleep>                    sleep;
-        std::deque<std::string_view>                   io_msdeque;
-        asio::ip::tcp::endpoint                        remote;
-        asio::ip::tcp::endpoint                        local;
+        asio_outbound_queue                            io_msdeque;
+        std::unique_ptr<asio_frame_codec>              io_codec;
+        std::string                                    io_frame;
+        bool                                           io_greeted;                                  // hello frame sent
+        /**
+         * @brief Progress of a `migrate` call: the reader stops first, then the writer hands over.
+         */
+        struct migrate_state
+        {
+            asio_context*                               target = nullptr;
+            bool                                        cancelled = false;                          // the reader's read was cancelled
+            bool                                        parked = false;                             // the reader stopped
+        }                                              migration;
+        endpoint_type                                  remote;
+        endpoint_type                                  local;
+        asio_session_metrics                           metrics;
+        asio_rate_buckets                              rate;
+#if defined(SO_ZEROCOPY)
+        /**
+         * @brief Buffers of zero-copy sends, held until the kernel reports them done.
+         */
+        struct zerocopy_state
+        {
+            std::size_t                                 threshold = 0;
+            std::uint32_t                               sent = 0;                                   // zero-copy send calls so far
+            std::uint32_t                               done = 0;                                   // send calls the kernel is done with
+            bool                                        reaping = false;
+            std::deque<std::pair<std::uint32_t, std::string>> pending;
+        }                                              zerocopy;
+#endif
+#if defined(TCP_CORK)
+        /**
+         * @brief Adaptive corking of the writer, see `set_profile`.
+         */
+        struct cork_state
+        {
+            bool                                        adaptive = false;
+            bool                                        corked = false;
+        }                                              cork;
+#endif
     };
+
+    using asio_session = asio_stream_session<asio::ip::tcp>;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    using asio_local_session = asio_stream_session<asio::local::stream_protocol>;
+#endif
 }
 
 #endif // __ASIO_CHANNEL_H__
\ No newline at end of file
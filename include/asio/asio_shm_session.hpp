@@ -0,0 +1,712 @@
+﻿#ifndef __ASIO_SHM_SESSION_H__
+#define __ASIO_SHM_SESSION_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_log.hpp"
+#include "asio_metrics.hpp"
+#include "asio_observer.hpp"
+#include "asio_trace.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+
+#if defined(__linux__)
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ik
+{
+    /**
+     * @brief Shared memory segment holding two single-producer single-consumer message rings, one per direction.
+     * @note Layout: a control block, the two ring headers, then the two data areas of `capacity` bytes each.
+     *       Messages are stored as a 32-bit length followed by the payload, padded to 8 bytes, and never wrap:
+     *       when the end of the data area is too close the producer writes a skip marker and starts over at the beginning.
+     *       Each side also has an eventfd doorbell, rung by the peer only when this side has flagged itself as waiting.
+     */
+    class asio_shm_segment
+    {
+    public:
+        static constexpr std::uint64_t magic = 0x31474E4952534B49ull;                                // "IKSRING1"
+        static constexpr std::uint32_t skip = 0xFFFFFFFFu;
+        static constexpr std::size_t data_offset = 4096;
+
+        struct control
+        {
+            std::uint64_t                               magic;
+            std::uint64_t                               capacity;
+        };
+
+        struct ring
+        {
+            alignas(64) std::atomic_uint64_t            head;                                       // written by the consumer
+            alignas(64) std::atomic_uint64_t            tail;                                       // written by the producer
+            alignas(64) std::atomic_uint32_t            reader_waiting;
+            std::atomic_uint32_t                        writer_waiting;
+            std::atomic_uint32_t                        closed;                                     // the producer is gone
+        };
+
+        static_assert(std::atomic_uint64_t::is_always_lock_free && std::atomic_uint32_t::is_always_lock_free, "shared memory atomics must be lock-free");
+        static_assert(sizeof(control) + 2 * sizeof(ring) <= data_offset, "ring headers do not fit");
+    public:
+        /**
+         * @brief Map a segment.
+         * @param memfd - The memory file, owned by the segment from now on.
+         * @param doorbell - The eventfd this side waits on, owned by the segment.
+         * @param peer - The eventfd of the other side, owned by the segment.
+         * @param side - 0 for the side that writes ring 0 and reads ring 1, 1 for the other.
+         */
+        asio_shm_segment(int memfd, int doorbell, int peer, int side)
+            : memfd(memfd)
+            , doorbell(doorbell)
+            , peer(peer)
+            , side(side)
+            , base(nullptr)
+            , size(0)
+        {
+            struct stat st{};
+
+            if (::fstat(memfd, &st) != 0 || static_cast<std::size_t>(st.st_size) <= data_offset)
+            {
+                release();
+                throw asio::error_code(asio::error::invalid_argument);
+            }
+
+            size = static_cast<std::size_t>(st.st_size);
+
+            if ((base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0)) == MAP_FAILED)
+            {
+                base = nullptr;
+                release();
+                throw asio::error_code(errno, asio::error::get_system_category());
+            }
+
+            const control* ctl = static_cast<const control*>(base);
+
+            if (ctl->magic != magic || data_offset + 2 * ctl->capacity != size)
+            {
+                release();
+                throw asio::error_code(asio::error::invalid_argument);
+            }
+        }
+        virtual ~asio_shm_segment()
+        {
+            release();
+        }
+    private:
+        asio_shm_segment(const asio_shm_segment&) = delete;
+        asio_shm_segment& operator=(const asio_shm_segment&) = delete;
+    public:
+        /**
+         * @brief Create the file descriptors of a new segment: the memory file and the doorbells of side 0 and side 1.
+         * @param capacity - The size of each ring in bytes, rounded up to a power of two.
+         */
+        static std::array<int, 3> create(std::size_t capacity)
+        {
+            std::size_t cap = 4096;
+
+            for (; cap < capacity; cap <<= 1)
+            {
+            }
+
+            std::array<int, 3> fds = { ::memfd_create("asio_shm_session", MFD_CLOEXEC), ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) };
+            int err = errno;
+
+            if (fds[0] >= 0 && fds[1] >= 0 && fds[2] >= 0 && ::ftruncate(fds[0], static_cast<off_t>(data_offset + 2 * cap)) == 0)
+            {
+                control ctl{ magic, cap };
+
+                if (::pwrite(fds[0], &ctl, sizeof(ctl), 0) == static_cast<ssize_t>(sizeof(ctl)))
+                {
+                    return fds;
+                }
+            }
+
+            err = errno ? errno : err;
+
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                }
+            }
+
+            throw asio::error_code(err, asio::error::get_system_category());
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return static_cast<std::size_t>(static_cast<const control*>(base)->capacity);
+        }
+
+        /**
+         * @brief The largest message that fits, half a ring so a message can always follow a skip marker.
+         */
+        std::size_t max_message() const noexcept
+        {
+            return capacity() / 2 - 8;
+        }
+
+        ring& outbound() noexcept
+        {
+            return header(side);
+        }
+
+        ring& inbound() noexcept
+        {
+            return header(side ^ 1);
+        }
+
+        char* outbound_data() noexcept
+        {
+            return data(side);
+        }
+
+        char* inbound_data() noexcept
+        {
+            return data(side ^ 1);
+        }
+
+        int get_memfd() const noexcept
+        {
+            return memfd;
+        }
+
+        /**
+         * @brief Release the doorbell descriptor, for the caller to wrap into a `stream_descriptor`.
+         */
+        int take_doorbell() noexcept
+        {
+            return std::exchange(doorbell, -1);
+        }
+
+        void ring_peer() noexcept
+        {
+            std::uint64_t one = 1;
+            [[maybe_unused]] ssize_t n = ::write(peer, &one, sizeof(one));
+        }
+    private:
+        ring& header(int n) noexcept
+        {
+            return reinterpret_cast<ring*>(static_cast<char*>(base) + sizeof(control))[n];
+        }
+
+        char* data(int n) noexcept
+        {
+            return static_cast<char*>(base) + data_offset + static_cast<std::size_t>(n) * capacity();
+        }
+
+        void release() noexcept
+        {
+            if (base != nullptr)
+            {
+                ::munmap(base, size), base = nullptr;
+            }
+
+            for (int* fd : { &memfd, &doorbell, &peer })
+            {
+                if (*fd >= 0)
+                {
+                    ::close(*fd), *fd = -1;
+                }
+            }
+        }
+    private:
+        int                                             memfd;
+        int                                             doorbell;
+        int                                             peer;
+        int                                             side;
+        void*                                           base;
+        std::size_t                                     size;
+    };
+
+    /**
+     * @brief A session exchanging messages with a peer on the same host through shared memory.
+     * @note Sending copies the message into the shared ring and costs no system call unless the peer is idle, in which
+     *       case its eventfd is written once to wake it. Received messages are handed to the handler in place, without
+     *       a copy. The binder events match `asio_session` with this session type:
+     *       - `bind_type::recv` as `(asio_context&, asio_shm_session&, const char* buf, std::size_t n)`, `buf` is only valid during the call
+     *       - `bind_type::disconnect` as `(asio_context&, asio_shm_session&, asio_error& ec)` when either side closes,
+     *         `EPROTO` if the peer wrote a record that does not fit its ring
+     *       Messages are delivered whole and in order, up to `max_message()` bytes. Peers are set up with `make_pair` in
+     *       one process, or with `offer`/`accept` over a connected Unix socket across processes. A peer process that dies
+     *       without closing is not detected, watch the Unix socket for that.
+     * @example
+     * // process A                                                                      // process B
+     * auto a = asio_shm_session::offer(ctx, binder, unix_socket, 0);                     auto b = asio_shm_session::accept(ctx, binder, unix_socket, 0);
+     * a->init();                                                                         b->init();
+     * a->async_writer("hello");
+     */
+    class asio_shm_session : public std::enable_shared_from_this<asio_shm_session>
+    {
+    public:
+        static constexpr std::size_t batch_cnt = 256;
+    public:
+        explicit asio_shm_session(asio_context& io_context, asio_binder& binder, std::unique_ptr<asio_shm_segment> segment, std::size_t id)
+            : self(std::ref(*this))
+            , io_context(io_context)
+            , io_strand(io_context.get_executor())
+            , binder(binder)
+            , segment(std::move(segment))
+            , doorbell(io_context, this->segment->take_doorbell())
+            , id(id)
+            , sleeping(false)
+            , closed(false)
+        {
+        }
+        virtual ~asio_shm_session()
+        {
+            if (!io_msdeque.empty())
+            {
+                io_context.get_metrics().add(metric_type::queue_depth, -static_cast<std::int64_t>(io_msdeque.size()));
+            }
+        }
+    private:
+        asio_shm_session(const asio_shm_session&) = delete;
+        asio_shm_session& operator=(const asio_shm_session&) = delete;
+    public:
+        /**
+         * @brief Create two connected sessions in this process, e.g. between two contexts.
+         * @param capacity - The size of each ring in bytes.
+         */
+        static std::pair<std::shared_ptr<asio_shm_session>, std::shared_ptr<asio_shm_session>> make_pair(asio_context& a_context, asio_binder& a_binder,
+                                                                                                          asio_context& b_context, asio_binder& b_binder,
+                                                                                                          std::size_t capacity = 1 << 20)
+        {
+            std::array<int, 3> fds = asio_shm_segment::create(capacity);
+            std::array<int, 3> dup = { ::dup(fds[0]), ::dup(fds[1]), ::dup(fds[2]) };
+
+            auto a = std::make_shared<asio_shm_session>(a_context, a_binder, std::make_unique<asio_shm_segment>(fds[0], fds[1], fds[2], 0), 0);
+            auto b = std::make_shared<asio_shm_session>(b_context, b_binder, std::make_unique<asio_shm_segment>(dup[0], dup[2], dup[1], 1), 1);
+            return { a, b };
+        }
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+        /**
+         * @brief Create a segment and pass it to the peer process over a connected Unix socket.
+         * @param socket - A connected Unix stream socket, the peer calls `accept` on its end. Only used during the call.
+         * @param capacity - The size of each ring in bytes.
+         * @return Returns the session of this side, not yet initialized.
+         * @note Blocks until the descriptors are sent. Throws `asio::error_code` on failure.
+         */
+        static std::shared_ptr<asio_shm_session> offer(asio_context& io_context, asio_binder& binder, asio_local_socket& socket, std::size_t id, std::size_t capacity = 1 << 20)
+        {
+            std::array<int, 3> fds = asio_shm_segment::create(capacity);
+            auto segment = std::make_unique<asio_shm_segment>(fds[0], fds[1], fds[2], 0);
+            char tag = 'S';
+            iovec iov{ &tag, 1 };
+            alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(fds))] = {};
+            msghdr msg{};
+
+            msg.msg_iov = &iov, msg.msg_iovlen = 1, msg.msg_control = buf, msg.msg_controllen = sizeof(buf);
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET, cmsg->cmsg_type = SCM_RIGHTS, cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+
+            // The peer gets side 1: its doorbell is our peer descriptor and the other way round.
+            int passed[3] = { fds[0], fds[2], fds[1] };
+            std::memcpy(CMSG_DATA(cmsg), passed, sizeof(passed));
+
+            if (::sendmsg(socket.native_handle(), &msg, MSG_NOSIGNAL) != 1)
+            {
+                throw asio::error_code(errno, asio::error::get_system_category());
+            }
+
+            return std::make_shared<asio_shm_session>(io_context, binder, std::move(segment), id);
+        }
+
+        /**
+         * @brief Receive a segment offered by the peer process over a connected Unix socket.
+         * @return Returns the session of this side, not yet initialized.
+         * @note Blocks until the descriptors arrive. Throws `asio::error_code` on failure.
+         */
+        static std::shared_ptr<asio_shm_session> accept(asio_context& io_context, asio_binder& binder, asio_local_socket& socket, std::size_t id)
+        {
+            int fds[3] = { -1, -1, -1 };
+            char tag = 0;
+            iovec iov{ &tag, 1 };
+            alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(fds))] = {};
+            msghdr msg{};
+
+            msg.msg_iov = &iov, msg.msg_iovlen = 1, msg.msg_control = buf, msg.msg_controllen = sizeof(buf);
+
+            ssize_t n = 0;
+
+            while ((n = ::recvmsg(socket.native_handle(), &msg, MSG_CMSG_CLOEXEC)) < 0 && (errno == EINTR || errno == EAGAIN))
+            {
+                pollfd pfd{ socket.native_handle(), POLLIN, 0 };
+                ::poll(&pfd, 1, -1);
+            }
+
+            cmsghdr* cmsg = n == 1 && tag == 'S' ? CMSG_FIRSTHDR(&msg) : nullptr;
+
+            if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+            {
+                throw asio::error_code(n < 0 ? errno : EPROTO, asio::error::get_system_category());
+            }
+
+            std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+            return std::make_shared<asio_shm_session>(io_context, binder, std::make_unique<asio_shm_segment>(fds[0], fds[1], fds[2], 1), id);
+        }
+#endif
+
+        asio_shm_session& init()
+        {
+            io_context.dispatch([&]
+            {
+                try
+                {
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->pump(); }, asio::bind_executor(io_strand, asio::detached));
+                    io_context.get_metrics().add(metric_type::sessions);
+                }
+                catch (const std::exception&)
+                {
+                }
+            });
+
+            return *this;
+        }
+
+        /**
+         * @brief Send a message to the peer.
+         * @param buffer - The message, copied into the ring (or into a local queue while the ring is full).
+         * @note Messages longer than `max_message()` are dropped and counted as `asio::error::message_size` errors.
+         */
+        asio_shm_session& async_writer(const std::string_view& buffer)
+        {
+            if (io_context.running_in_this_thread())
+            {
+                if (closed)
+                {
+                    return *this;
+                }
+
+                if (buffer.size() > segment->max_message())
+                {
+                    io_context.get_metrics().error(asio::error::message_size);
+                    return *this;
+                }
+
+                if (io_msdeque.empty() && push(buffer))
+                {
+                    return *this;
+                }
+
+                io_msdeque.emplace_back(buffer);
+                count(metric_type::queue_depth);
+                ASIO_TRACE(enqueue, id, buffer.size());
+
+                // The pump only waits for ring space it knows about, wake it to notice the queue.
+                if (sleeping)
+                {
+                    std::uint64_t one = 1;
+                    [[maybe_unused]] ssize_t n = ::write(doorbell.native_handle(), &one, sizeof(one));
+                }
+            }
+            else
+            {
+                io_context.dispatch([self = this->shared_from_this(), data = std::string(buffer)] { self->async_writer(data); });
+            }
+
+            return *this;
+        }
+
+        std::size_t index() const
+        {
+            return id;
+        }
+
+        bool is_open() const
+        {
+            return !closed;
+        }
+
+        std::size_t max_message() const noexcept
+        {
+            return segment->max_message();
+        }
+
+        const asio_session_metrics& get_metrics() const noexcept
+        {
+            return metrics;
+        }
+
+        /**
+         * @brief Close this side. The peer gets `bind_type::disconnect` once it has read everything sent before.
+         */
+        void close()
+        {
+            try
+            {
+                if (io_context.running_in_this_thread())
+                {
+                    if (!std::exchange(closed, true))
+                    {
+                        ASIO_TRACE(close, id, 0);
+                        segment->outbound().closed.store(1, std::memory_order_release);
+                        segment->ring_peer();
+
+                        asio::error_code ec;
+                        doorbell.cancel(ec);
+                    }
+                }
+                else
+                {
+                    io_context.dispatch([self = this->shared_from_this()] { self->close(); });
+                }
+            }
+            catch (const std::exception&)
+            {
+                // Exception handling (e.g., logging) can be added here.
+            }
+        }
+    private:
+        /**
+         * @brief Copy a message into the outbound ring and wake the peer if it is waiting.
+         * @return Returns `false` if the ring has no room for the message.
+         */
+        bool push(const std::string_view& buffer) noexcept
+        {
+            asio_shm_segment::ring& ring = segment->outbound();
+            std::size_t cap = segment->capacity();
+            std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+            std::uint64_t head = ring.head.load(std::memory_order_acquire);
+            std::size_t off = static_cast<std::size_t>(tail & (cap - 1));
+            std::size_t rec = (sizeof(std::uint32_t) + buffer.size() + 7) & ~static_cast<std::size_t>(7);
+            std::size_t room = cap - off;
+
+            if (cap - static_cast<std::size_t>(tail - head) < (room < rec ? room + rec : rec))
+            {
+                return false;
+            }
+
+            char* data = segment->outbound_data();
+
+            if (room < rec)
+            {
+                std::memcpy(data + off, &asio_shm_segment::skip, sizeof(std::uint32_t));
+                tail += room, off = 0;
+            }
+
+            std::uint32_t n = static_cast<std::uint32_t>(buffer.size());
+            std::memcpy(data + off, &n, sizeof(n));
+            std::memcpy(data + off + sizeof(n), buffer.data(), buffer.size());
+            ring.tail.store(tail + rec, std::memory_order_release);
+
+            // Pairs with the fence of a reader going to sleep: either it sees the new tail or we see its flag.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (ring.reader_waiting.load(std::memory_order_relaxed) != 0 && ring.reader_waiting.exchange(0) != 0)
+            {
+                segment->ring_peer();
+            }
+
+            count(metric_type::bytes_out, static_cast<std::int64_t>(buffer.size())), count(metric_type::messages_out);
+            ASIO_TRACE(write, id, buffer.size());
+            return true;
+        }
+
+        /**
+         * @brief Hand up to `batch_cnt` inbound messages to the binder.
+         * @return Returns the number of messages read.
+         * @note The peer process writes the ring, so the tail and every length are checked against it before use.
+         *       A record that does not fit closes the session with `EPROTO`.
+         */
+        std::size_t drain()
+        {
+            asio_shm_segment::ring& ring = segment->inbound();
+            std::size_t cap = segment->capacity(), n = 0;
+            char* data = segment->inbound_data();
+            std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+            std::uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+            if (tail - head > cap)
+            {
+                violate();
+            }
+
+            for (; head != tail && n < batch_cnt && !closed; )
+            {
+                std::size_t off = static_cast<std::size_t>(head & (cap - 1));
+                std::uint64_t left = tail - head;
+                std::uint32_t len = 0;
+                std::memcpy(&len, data + off, sizeof(len));
+
+                if (len == asio_shm_segment::skip)
+                {
+                    if (cap - off > left)
+                    {
+                        violate();
+                        break;
+                    }
+
+                    head += cap - off;
+                    continue;
+                }
+
+                if (len > cap - off - sizeof(len) || ((sizeof(len) + len + 7) & ~static_cast<std::uint64_t>(7)) > left)
+                {
+                    violate();
+                    break;
+                }
+
+                std::size_t size = len;
+                count(metric_type::bytes_in, static_cast<std::int64_t>(size)), count(metric_type::messages_in);
+                ASIO_TRACE(read, id, size);
+                binder.notify(bind_type::recv, io_context, self, static_cast<const char*>(data + off + sizeof(len)), size);
+
+                head += (sizeof(len) + size + 7) & ~static_cast<std::uint64_t>(7);
+                ring.head.store(head, std::memory_order_release);
+                ++n;
+            }
+
+            ring.head.store(head, std::memory_order_release);
+
+            // Pairs with the fence of a writer waiting for room.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (ring.writer_waiting.load(std::memory_order_relaxed) != 0 && ring.writer_waiting.exchange(0) != 0)
+            {
+                segment->ring_peer();
+            }
+
+            return n;
+        }
+
+        /**
+         * @brief Close the session on a malformed inbound ring, the peer is not trusted further.
+         */
+        void violate()
+        {
+            failure = asio::error_code(EPROTO, asio::error::get_system_category());
+            io_context.get_metrics().error(failure);
+            this->close();
+        }
+
+        /**
+         * @brief Move queued messages into the outbound ring while it has room.
+         * @return Returns the number of messages moved.
+         */
+        std::size_t flush()
+        {
+            std::size_t n = 0;
+
+            for (; !io_msdeque.empty() && push(io_msdeque.front()); ++n)
+            {
+                io_msdeque.pop_front();
+            }
+
+            count(metric_type::queue_depth, -static_cast<std::int64_t>(n));
+            return n;
+        }
+
+        /**
+         * @brief Coroutine moving messages in both directions, sleeping on the doorbell when there is nothing to do.
+         */
+        asio::awaitable<void> pump()
+        {
+            asio::error_code ec;
+            asio_shm_segment::ring& in = segment->inbound();
+            asio_shm_segment::ring& out = segment->outbound();
+
+            try
+            {
+                for (; !closed; )
+                {
+                    if (drain() + flush() != 0)
+                    {
+                        // Let the other handlers of the context run between two batches.
+                        co_await asio::post(io_strand, asio::use_awaitable);
+                        continue;
+                    }
+
+                    if (closed || (in.closed.load(std::memory_order_acquire) != 0 && in.head.load(std::memory_order_relaxed) == in.tail.load(std::memory_order_acquire)))
+                    {
+                        break;
+                    }
+
+                    // Announce the wait, then look again so a message published in between is not missed.
+                    in.reader_waiting.store(1);
+                    out.writer_waiting.store(io_msdeque.empty() ? 0 : 1);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                    if (in.head.load(std::memory_order_relaxed) != in.tail.load(std::memory_order_acquire) || in.closed.load(std::memory_order_acquire) != 0 ||
+                        (!io_msdeque.empty() && flush() != 0))
+                    {
+                        in.reader_waiting.store(0), out.writer_waiting.store(0);
+                        continue;
+                    }
+
+                    sleeping = true;
+                    co_await doorbell.async_wait(asio::posix::stream_descriptor::wait_read, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                    sleeping = false;
+
+                    if (ec)
+                    {
+                        if (ec != asio::error::operation_aborted)
+                        {
+                            io_context.get_metrics().error(ec);
+                        }
+                    }
+                    else
+                    {
+                        std::uint64_t value = 0;
+                        [[maybe_unused]] ssize_t n = ::read(doorbell.native_handle(), &value, sizeof(value));
+                    }
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                ASIO_LOG_ERROR("%s", ex.what());
+            }
+
+            this->close();
+            ec = failure ? failure : in.closed.load(std::memory_order_acquire) != 0 ? asio::error_code(asio::error::eof) : asio::error_code(asio::error::operation_aborted);
+            io_context.get_metrics().add(metric_type::disconnects), io_context.get_metrics().add(metric_type::sessions, -1);
+            binder.notify(bind_type::disconnect, io_context, self, ec);
+        }
+
+        /**
+         * @brief Add to a counter of both this session and its context.
+         */
+        void count(metric_type type, std::int64_t n = 1) noexcept
+        {
+            io_context.get_metrics().add(type, n);
+            metrics.add(type, n);
+        }
+    private:
+        asio_shm_session&                               self;
+        asio_context&                                   io_context;
+        asio::strand<asio::io_context::executor_type>   io_strand;
+        asio_binder&                                    binder;
+        std::unique_ptr<asio_shm_segment>               segment;
+        asio::posix::stream_descriptor                  doorbell;
+        std::size_t                                     id;
+        bool                                            sleeping;
+        bool                                            closed;
+        asio::error_code                                failure;                                    // why the pump stopped, if the peer broke the ring
+        std::deque<std::string>                         io_msdeque;
+        asio_session_metrics                            metrics;
+    };
+}
+
+#endif // defined(__linux__)
+
+#endif // __ASIO_SHM_SESSION_H__
\ No newline at end of file
@@ -0,0 +1,157 @@
+﻿#ifndef __ASIO_SOCKET_PROFILE_H__
+#define __ASIO_SOCKET_PROFILE_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_log.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <optional>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace ik
+{
+    /**
+     * @brief Socket options applied by a server when it listens and accepts, and by a client before it connects.
+     * @note Options left unset keep the system default. TCP options are skipped for other protocols, and the Linux-only
+     *       ones (`quick_ack`, `busy_poll`, `defer_accept`, `adaptive_cork`) are ignored elsewhere. An option the system
+     *       refuses, e.g. `busy_poll` without `CAP_NET_ADMIN`, is logged at debug level and does not fail the socket.
+     * @example
+     * server->set_profile(asio_socket_profile::throughput()).async_listen(6666);
+     */
+    struct asio_socket_profile
+    {
+        std::optional<bool>                             no_delay;
+        std::optional<bool>                             keep_alive;
+        std::optional<bool>                             reuse_address;
+        std::optional<int>                              send_buffer;
+        std::optional<int>                              receive_buffer;
+        std::optional<bool>                             quick_ack;                                  // re-armed by the kernel, applied once per connection
+        std::optional<int>                              busy_poll;                                  // microseconds
+        std::optional<int>                              defer_accept;                               // seconds to wait for the first data
+        int                                             backlog = asio::socket_base::max_listen_connections;
+        bool                                            adaptive_cork = false;                      // cork while the write queue fills
+
+        /**
+         * @brief A profile for request/response traffic: no Nagle delay, immediate acks, busy polling.
+         */
+        static asio_socket_profile latency()
+        {
+            asio_socket_profile profile;
+            profile.no_delay = true, profile.quick_ack = true, profile.busy_poll = 50;
+            return profile;
+        }
+
+        /**
+         * @brief A profile for bulk transfers: large buffers, and full segments by corking queued writes together.
+         */
+        static asio_socket_profile throughput()
+        {
+            asio_socket_profile profile;
+            profile.no_delay = true, profile.send_buffer = 4 << 20, profile.receive_buffer = 4 << 20, profile.adaptive_cork = true;
+            return profile;
+        }
+
+        /**
+         * @brief Apply the options of a connection, to an accepted socket or to a client socket before it connects.
+         */
+        template <typename Socket>
+        void apply(Socket& socket) const
+        {
+            asio_error ec;
+
+            if (send_buffer)
+            {
+                socket.set_option(asio::socket_base::send_buffer_size(*send_buffer), ec), check(ec, "SO_SNDBUF");
+            }
+
+            if (receive_buffer)
+            {
+                socket.set_option(asio::socket_base::receive_buffer_size(*receive_buffer), ec), check(ec, "SO_RCVBUF");
+            }
+
+            if constexpr (std::is_same_v<typename Socket::protocol_type, asio::ip::tcp>)
+            {
+                if (no_delay)
+                {
+                    socket.set_option(asio::ip::tcp::no_delay(*no_delay), ec), check(ec, "TCP_NODELAY");
+                }
+
+                if (keep_alive)
+                {
+                    socket.set_option(asio::socket_base::keep_alive(*keep_alive), ec), check(ec, "SO_KEEPALIVE");
+                }
+
+#if defined(__linux__)
+                if (quick_ack)
+                {
+                    set(socket.native_handle(), IPPROTO_TCP, TCP_QUICKACK, *quick_ack ? 1 : 0, "TCP_QUICKACK");
+                }
+
+                if (busy_poll)
+                {
+                    set(socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL, *busy_poll, "SO_BUSY_POLL");
+                }
+#endif
+            }
+        }
+
+        /**
+         * @brief Apply the options of a listener between `open` and `bind`. Buffer sizes set here are inherited by accepted sockets.
+         */
+        template <typename Acceptor>
+        void apply_listener(Acceptor& acceptor) const
+        {
+            asio_error ec;
+
+            if (reuse_address)
+            {
+                acceptor.set_option(asio::socket_base::reuse_address(*reuse_address), ec), check(ec, "SO_REUSEADDR");
+            }
+
+            if (receive_buffer)
+            {
+                acceptor.set_option(asio::socket_base::receive_buffer_size(*receive_buffer), ec), check(ec, "SO_RCVBUF");
+            }
+
+#if defined(__linux__)
+            if constexpr (std::is_same_v<typename Acceptor::protocol_type, asio::ip::tcp>)
+            {
+                if (defer_accept)
+                {
+                    set(acceptor.native_handle(), IPPROTO_TCP, TCP_DEFER_ACCEPT, *defer_accept, "TCP_DEFER_ACCEPT");
+                }
+            }
+#endif
+        }
+    private:
+        static void check(const asio_error& ec, const char* name)
+        {
+            if (ec)
+            {
+                ASIO_LOG_DEBUG("socket option %s: %s", name, ec.message().c_str());
+            }
+        }
+
+#if defined(__linux__)
+        static void set(int fd, int level, int option, int value, const char* name)
+        {
+            if (::setsockopt(fd, level, option, &value, sizeof(value)) != 0)
+            {
+                check(asio_error(errno, asio::error::get_system_category()), name);
+            }
+        }
+#endif
+    };
+}
+
+#endif // __ASIO_SOCKET_PROFILE_H__
\ No newline at end of file
@@ -0,0 +1,321 @@
+﻿#ifndef __ASIO_SSL_H__
+#define __ASIO_SSL_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_session.hpp"
+#include "asio_tcp_client.hpp"
+#include "asio_tcp_server_basic.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+
+#include <openssl/ssl.h>
+
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace ik
+{
+    /**
+     * @brief TLS configuration shared by the connections of a server or a client, with the sessions kept for resumption.
+     * @note A server resumes sessions from its session ID cache and with session tickets, both on by default.
+     *       A client keeps the last session of every peer (server name and endpoint) and offers it on the next connect,
+     *       so reconnects skip the full handshake. Configure the context before the first connection, the session
+     *       cache can then be used from any thread.
+     * @example
+     * asio_ssl_context server_tls;
+     * server_tls.use_certificate("server.crt", "server.key");
+     * auto server = std::make_shared<asio_ssl_server_basic>(io_context, binder, server_tls);
+     *
+     * asio_ssl_context client_tls;
+     * client_tls.set_verify_peer("ca.crt").set_server_name("service.local");
+     * auto client = std::make_shared<asio_ssl_client>(io_context, binder, client_tls);
+     */
+    class asio_ssl_context
+    {
+    public:
+        explicit asio_ssl_context(asio::ssl::context::method method = asio::ssl::context::tls)
+            : context(method)
+            , cache_size(1024)
+        {
+            static const unsigned char id_context[] = "ik::asio_ssl_context";
+
+            context.set_options(asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::no_sslv3);
+
+            SSL_CTX_set_app_data(context.native_handle(), this);
+            SSL_CTX_set_session_id_context(context.native_handle(), id_context, sizeof(id_context) - 1);
+            SSL_CTX_set_session_cache_mode(context.native_handle(), SSL_SESS_CACHE_BOTH);
+            SSL_CTX_sess_set_new_cb(context.native_handle(), &asio_ssl_context::on_new_session);
+            SSL_CTX_sess_set_cache_size(context.native_handle(), static_cast<long>(cache_size));
+        }
+        virtual ~asio_ssl_context()
+        {
+            for (auto& [key, session] : sessions)
+            {
+                SSL_SESSION_free(session);
+            }
+        }
+    private:
+        asio_ssl_context(const asio_ssl_context&) = delete;
+        asio_ssl_context& operator=(const asio_ssl_context&) = delete;
+    public:
+        /**
+         * @brief Load the certificate chain and the private key presented by this side, from PEM files.
+         * @note Throws `asio::system_error` if a file cannot be loaded.
+         */
+        asio_ssl_context& use_certificate(const std::string& cert_chain_file, const std::string& private_key_file)
+        {
+            context.use_certificate_chain_file(cert_chain_file);
+            context.use_private_key_file(private_key_file, asio::ssl::context::pem);
+            return *this;
+        }
+
+        /**
+         * @brief Load the certificate chain and the private key presented by this side, from PEM text in memory.
+         */
+        asio_ssl_context& use_certificate_pem(const std::string_view& cert_chain, const std::string_view& private_key)
+        {
+            context.use_certificate_chain(asio::buffer(cert_chain.data(), cert_chain.size()));
+            context.use_private_key(asio::buffer(private_key.data(), private_key.size()), asio::ssl::context::pem);
+            return *this;
+        }
+
+        /**
+         * @brief Require and verify the certificate of the peer.
+         * @param ca_file - The PEM file of the trusted certificates, empty for the system's default trust store.
+         */
+        asio_ssl_context& set_verify_peer(const std::string& ca_file = std::string())
+        {
+            if (ca_file.empty())
+            {
+                context.set_default_verify_paths();
+            }
+            else
+            {
+                context.load_verify_file(ca_file);
+            }
+
+            context.set_verify_mode(asio::ssl::verify_peer | asio::ssl::verify_fail_if_no_peer_cert);
+            return *this;
+        }
+
+        /**
+         * @brief Set the server name a client sends (SNI) and, when verifying the peer, checks the certificate against.
+         */
+        asio_ssl_context& set_server_name(const std::string& name)
+        {
+            server_name = name;
+            return *this;
+        }
+
+        /**
+         * @brief Size the session caches and set how long a session can be resumed.
+         * @param size - The number of sessions kept, by the server's session ID cache and by the client for its peers.
+         * @param timeout - The lifetime of a session issued by a server.
+         */
+        asio_ssl_context& set_session_cache(std::size_t size, const std::chrono::seconds& timeout = std::chrono::seconds(7200))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            cache_size = size;
+            SSL_CTX_sess_set_cache_size(context.native_handle(), static_cast<long>(size));
+            SSL_CTX_set_timeout(context.native_handle(), static_cast<long>(timeout.count()));
+            SSL_CTX_set_session_cache_mode(context.native_handle(), size == 0 ? SSL_SESS_CACHE_OFF : SSL_SESS_CACHE_BOTH);
+            return *this;
+        }
+
+        /**
+         * @brief Enable or disable session tickets, with which a server resumes sessions without keeping them.
+         */
+        asio_ssl_context& set_session_tickets(bool enable)
+        {
+            if (enable)
+            {
+                SSL_CTX_clear_options(context.native_handle(), SSL_OP_NO_TICKET);
+            }
+            else
+            {
+                SSL_CTX_set_options(context.native_handle(), SSL_OP_NO_TICKET);
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Get the underlying asio context, for settings not covered here.
+         */
+        asio::ssl::context& native() noexcept
+        {
+            return context;
+        }
+
+        /**
+         * @brief Get the number of peers a client holds a session for.
+         */
+        std::size_t cached_sessions()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return sessions.size();
+        }
+
+        /**
+         * @brief Prepare the client side of a connection: server name, host check and the session to resume.
+         * @param ssl - The connection.
+         * @param peer - The remote endpoint, as text.
+         */
+        void prepare(SSL* ssl, const std::string& peer)
+        {
+            std::string key = server_name + '|' + peer;
+
+            if (!server_name.empty())
+            {
+                SSL_set_tlsext_host_name(ssl, server_name.c_str());
+
+                if (SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER)
+                {
+                    SSL_set1_host(ssl, server_name.c_str());
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (auto it = sessions.find(key); it != sessions.end())
+                {
+                    SSL_set_session(ssl, it->second);
+                }
+            }
+
+            SSL_set_ex_data(ssl, key_index(), new std::string(std::move(key)));
+        }
+    private:
+        /**
+         * @brief Index of the peer key attached to a client connection, freed with the connection.
+         */
+        static int key_index()
+        {
+            static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, [] (void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+            {
+                delete static_cast<std::string*>(ptr);
+            });
+
+            return index;
+        }
+
+        /**
+         * @brief Keep a session issued to a client, replacing the previous one of the same peer. A server's sessions stay in OpenSSL's own cache.
+         * @return Returns 1 when the session is kept, OpenSSL then leaves its reference to us.
+         */
+        static int on_new_session(SSL* ssl, SSL_SESSION* session)
+        {
+            auto* self = static_cast<asio_ssl_context*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+            auto* key = static_cast<std::string*>(SSL_get_ex_data(ssl, key_index()));
+
+            if (self == nullptr || key == nullptr || SSL_is_server(ssl))
+            {
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> lock(self->mutex);
+
+            if (auto it = self->sessions.find(*key); it != self->sessions.end())
+            {
+                SSL_SESSION_free(std::exchange(it->second, session));
+                return 1;
+            }
+
+            if (self->cache_size == 0)
+            {
+                return 0;
+            }
+
+            if (self->sessions.size() >= self->cache_size)
+            {
+                SSL_SESSION_free(self->sessions.begin()->second);
+                self->sessions.erase(self->sessions.begin());
+            }
+
+            self->sessions.emplace(*key, session);
+            return 1;
+        }
+    private:
+        asio::ssl::context                              context;
+        std::string                                     server_name;
+        std::size_t                                     cache_size;
+        std::mutex                                      mutex;
+        std::unordered_map<std::string, SSL_SESSION*>   sessions;
+    };
+
+    /**
+     * @brief TLS streams: created over an accepted or connected socket, ready for a session after the handshake.
+     */
+    template <typename Socket>
+    struct asio_stream_traits<asio::ssl::stream<Socket>>
+    {
+        using context_type = asio_ssl_context;
+        using stream_type = asio::ssl::stream<Socket>;
+
+        static constexpr bool secure = true;
+
+        static stream_type make(Socket&& socket, asio_ssl_context& context)
+        {
+            return stream_type(std::move(socket), context.native());
+        }
+
+        static asio::awaitable<asio_error> async_accept(stream_type& stream, asio_ssl_context& context)
+        {
+            asio_error ec;
+            co_await stream.async_handshake(asio::ssl::stream_base::server, asio::redirect_error(asio::use_awaitable, ec));
+            co_return ec;
+        }
+
+        static asio::awaitable<asio_error> async_connect(stream_type& stream, asio_ssl_context& context)
+        {
+            asio_error ec;
+            std::ostringstream peer;
+
+            peer << stream.lowest_layer().remote_endpoint(ec);
+            context.prepare(stream.native_handle(), peer.str());
+
+            co_await stream.async_handshake(asio::ssl::stream_base::client, asio::redirect_error(asio::use_awaitable, ec));
+            co_return ec;
+        }
+
+        static bool resumed(stream_type& stream) noexcept
+        {
+            return SSL_session_reused(stream.native_handle()) == 1;
+        }
+
+        /**
+         * @brief Mark the connection as shut down before its socket is closed, without sending close_notify.
+         * @note OpenSSL drops the session of a connection freed without a shutdown, which would defeat resumption.
+         */
+        static void shutdown(stream_type& stream) noexcept
+        {
+            SSL_set_shutdown(stream.native_handle(), SSL_SENT_SHUTDOWN);
+        }
+
+        /**
+         * @brief Check for a peer that closed the connection without a TLS close_notify, which sessions treat as a normal close.
+         */
+        static bool truncated(const asio_error& ec) noexcept
+        {
+            return ec == asio::ssl::error::stream_truncated;
+        }
+    };
+
+    using asio_ssl_stream = asio::ssl::stream<asio_socket>;
+    using asio_ssl_session = asio_stream_session<asio::ip::tcp, asio_ssl_stream>;
+    using asio_ssl_server_basic = asio_stream_server_basic<asio::ip::tcp, asio_ssl_stream>;
+    using asio_ssl_client = asio_stream_client<asio::ip::tcp, asio_ssl_stream>;
+}
+
+#endif // __ASIO_SSL_H__
\ No newline at end of file
@@ -5,10 +5,23 @@
 #	pragma once
 #endif
 
+#include "asio_backoff.hpp"
 #include "asio_observer.hpp"
+#include "asio_resolver_cache.hpp"
 #include "asio_session.hpp"
+#include "asio_sleep.hpp"
+#include "asio_socket_profile.hpp"
 #include "asio_utils.hpp"
 
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
 namespace ik
 {
     struct MyStruct
@@ -16,17 +29,56 @@ namespace ik
         
     };
 
-    class asio_tcp_client : public std::enable_shared_from_this<asio_tcp_client>
+    /**
+     * @brief Connects sockets of a stream protocol and hands them to the binder through `bind_type::connect`.
+     * @tparam Protocol - The stream protocol, e.g. `asio::ip::tcp` (`asio_tcp_client`) or `asio::local::stream_protocol` (`asio_local_client`).
+     * @tparam Stream - The stream handed out, the protocol's socket or a TLS stream (`asio_ssl_client`).
+     * @note Host name resolution and the happy eyeballs race only exist for TCP.
+     *       For a secure stream the handshake runs before `bind_type::connect`, which then receives the stream instead of the
+     *       socket; a failed handshake is reported there as a failed attempt and retried like a failed connect.
+     */
+    template <typename Protocol, typename Stream = typename Protocol::socket>
+    class asio_stream_client : public std::enable_shared_from_this<asio_stream_client<Protocol, Stream>>
     {
     public:
-        explicit asio_tcp_client(asio_context& io_context, asio_binder& binder)
+        using protocol_type = Protocol;
+        using socket_type = typename Protocol::socket;
+        using endpoint_type = typename Protocol::endpoint;
+        using session_type = asio_stream_session<Protocol, Stream>;
+        using traits_type = asio_stream_traits<Stream>;
+        using context_type = typename traits_type::context_type;
+    public:
+        explicit asio_stream_client(asio_context& io_context, asio_binder& binder) requires (!traits_type::secure)
+            : io_context(io_context)
+            , binder(binder)
+            , io_strand(io_context.get_executor())
+            , connect_delay(250)
+            , connect_timeout(0)
+            , connect_max(0)
+            , connect_cnt(0)
+            , resolver_cache(std::addressof(asio_resolver_cache::instance()))
+            , stream_context(nullptr)
+        {
+
+        }
+        /**
+         * @param stream_context - The context of the secure streams, e.g. an `asio_ssl_context` holding the trusted
+         *        certificates and the sessions kept for resumption. It must outlive the client.
+         */
+        explicit asio_stream_client(asio_context& io_context, asio_binder& binder, context_type& stream_context) requires traits_type::secure
             : io_context(io_context)
             , binder(binder)
             , io_strand(io_context.get_executor())
+            , connect_delay(250)
+            , connect_timeout(0)
+            , connect_max(0)
+            , connect_cnt(0)
+            , resolver_cache(std::addressof(asio_resolver_cache::instance()))
+            , stream_context(std::addressof(stream_context))
         {
 
         }
-        virtual ~asio_tcp_client()
+        virtual ~asio_stream_client()
         {
 
         };
@@ -35,10 +87,10 @@ namespace ik
          * @brief Add an event handler for a specific event type.
          * @param e - The event type to bind the handler to.
          * @param val - The handler function to be invoked when the event occurs.
-         * @return Returns a reference to the current `asio_tcp_client` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
          */
         template <typename F>
-        asio_tcp_client& add(bind_type e, F&& val)
+        asio_stream_client& add(bind_type e, F&& val)
         {
             binder.add(e, std::forward<F>(val));
             return *this;
@@ -50,13 +102,13 @@ namespace ik
          * @param port - The port number of the remote server.
          * @note If a connection is already established (i.e., `channel` is not null), this function does nothing.
          */
-        asio_tcp_client& async_connect(const std::string& address, std::uint16_t port)
+        asio_stream_client& async_connect(const std::string& address, std::uint16_t port) requires std::is_same_v<Protocol, asio::ip::tcp>
         {
             asio::error_code ec;
 
             try
             {
-                return async_connect(asio_endpoint(asio::ip::make_address(address), port));
+                return async_connect(endpoint_type(asio::ip::make_address(address), port));
             }
             catch (const std::exception&)
             {
@@ -66,14 +118,21 @@ namespace ik
             return *this;
         }
 
-        asio_tcp_client& async_connect(const asio_endpoint& endpoint)
+        /**
+         * @brief Asynchronously connect to a remote endpoint.
+         * @param endpoint - The remote endpoint to connect to.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         * @note Failed attempts are retried according to the backoff policy set with `set_reconnect` (a single attempt by default).
+         *       Calling this from a `bind_type::disconnect` handler gives an auto-reconnect loop.
+         */
+        asio_stream_client& async_connect(const endpoint_type& endpoint)
         {
             asio::error_code ec;
 
             try
             {
                 asio::co_spawn(io_context, [self = this->shared_from_this(), endpoint] () -> asio::awaitable<void> {
-                    co_await self->connect(endpoint);
+                    co_await self->reconnect(endpoint);
                 }, asio::bind_executor(io_strand, asio::redirect_error(asio::detached, ec)));
             }
             catch (const std::exception&)
@@ -90,7 +149,7 @@ namespace ik
         * @param scheme - The scheme (e.g., "http", "https", or port number) used for resolving the address.
         * @note If a connection is already established (i.e., `channel` is not null), this function does nothing.
         */
-        asio_tcp_client& async_connect_resolver(const std::string& hostname, const std::string& scheme)
+        asio_stream_client& async_connect_resolver(const std::string& hostname, const std::string& scheme) requires std::is_same_v<Protocol, asio::ip::tcp>
         {
             asio::error_code ec;
 
@@ -114,22 +173,32 @@ namespace ik
          * @return Returns a boolean indicating whether the connection was successful.
          *         `true` if the connection was successful and `channel` is valid, otherwise `false`.
          * @note This function is a coroutine and must be awaited.
+         *       If the connect deadline expires, `bind_type::connect_timeout` is notified before `bind_type::connect`
+         *       reports the `asio::error::timed_out` failure.
          */
-        asio::awaitable<bool> connect(const asio_endpoint& endpoint)
+        asio::awaitable<bool> connect(const endpoint_type& endpoint)
         {
             asio::error_code ec;
-            asio_socket stream_socket(io_context);
+            socket_type stream_socket(io_context);
 
             try
             {
                 if (co_await binder.async_notify(bind_type::init, io_context, stream_socket),
-                    co_await stream_socket.async_connect(endpoint,
-                                                         asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                    ec = co_await connect_socket(stream_socket, endpoint), ec)
+                {
+                    if (asio::error_code ignored; stream_socket.close(ignored), ec == asio::error::timed_out)
+                    {
+                        co_await binder.async_notify(bind_type::connect_timeout, io_context, stream_socket, ec);
+                    }
+
+                    io_context.get_metrics().error(ec);
+                }
+                else
                 {
-                    stream_socket.close();
+                    io_context.get_metrics().add(metric_type::connects);
                 }
 
-                co_await binder.async_notify(bind_type::connect, io_context, stream_socket, ec);
+                co_await notify_connect(stream_socket, ec);
             }
             catch (const std::exception&)
             {
@@ -139,37 +208,506 @@ namespace ik
             co_return ec.value() == 0;
         }
 
+        /**
+         * @brief Coroutine to connect to a remote endpoint, retrying with jittered exponential backoff.
+         * @param endpoint - The remote endpoint to connect to.
+         * @return Returns `true` once connected, or `false` when the backoff policy gives up.
+         * @note Every attempt is reported through `bind_type::connect` as with `connect`.
+         */
+        asio::awaitable<bool> reconnect(endpoint_type endpoint)
+        {
+            asio::error_code ec;
+            asio_sleep sleep(io_context);
+
+            try
+            {
+                for (std::size_t n = 0; !co_await connect(endpoint); )
+                {
+                    if (!backoff.retry(++n))
+                    {
+                        co_return false;
+                    }
+
+                    co_await sleep.async_wait(backoff.delay(n - 1), asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                }
+            }
+            catch (const std::exception&)
+            {
+                co_return false;
+            }
+
+            co_return true;
+        }
+
         /**
          * @brief Asynchronously resolve and connect to a remote address using a coroutine.
          * @param query - The resolver query containing the address and scheme to resolve.
          * @note This function is a coroutine and must be awaited.
+         *       Resolved endpoints are raced "happy eyeballs" style (RFC 8305): address families are interleaved,
+         *       a new attempt starts every `connect_delay` or as soon as the previous attempts have all failed,
+         *       and the first established connection wins while the others are cancelled.
+         *       Lookups go through the client's `asio_resolver_cache`, so repeated connects to a host do not resolve it again.
+         */
+        asio::awaitable<void> connect_resolver(const asio_resolver::query& query) requires std::is_same_v<Protocol, asio::ip::tcp>
+        {
+            try
+            {
+                auto [ec, results] = co_await resolver_cache->async_resolve(io_context, query.host_name(), query.service_name());
+
+                if (std::vector<endpoint_type> endpoints = interleave(results); endpoints.size() == 1)
+                {
+                    co_await connect(endpoints.front());
+                }
+                else if (!endpoints.empty())
+                {
+                    co_await connect_race(std::move(endpoints));
+                }
+            }
+            catch (const std::exception&)
+            {
+
+            }
+        }
+
+        /**
+         * @brief Set the delay between two staggered connection attempts of `connect_resolver`.
+         * @param delay - The delay to wait for an attempt before starting the next one.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         */
+        asio_stream_client& set_connect_delay(const std::chrono::milliseconds& delay)
+        {
+            connect_delay = delay;
+            return *this;
+        }
+
+        /**
+         * @brief Set the deadline of a single connection attempt.
+         * @param timeout - The deadline, `0` to wait for the operating system's own connect timeout.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         */
+        asio_stream_client& set_connect_timeout(const std::chrono::milliseconds& timeout)
+        {
+            connect_timeout = timeout;
+            return *this;
+        }
+
+        /**
+         * @brief Set the retry policy used by `async_connect` and `reconnect`.
+         * @param policy - The backoff policy; `policy.attempts` bounds the number of attempts (0 = retry forever).
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         */
+        asio_stream_client& set_reconnect(const asio_backoff& policy)
+        {
+            backoff = policy;
+            return *this;
+        }
+
+        /**
+         * @brief Limit the number of connection attempts this client runs at the same time.
+         * @param n - The maximum number of concurrent attempts, `0` for no limit.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         * @note Attempts over the limit queue up in FIFO order until a running attempt completes.
+         */
+        asio_stream_client& set_connect_limit(std::size_t n)
+        {
+            connect_max = n;
+            return *this;
+        }
+
+        /**
+         * @brief Set the resolver cache used by `connect_resolver`.
+         * @param cache - The cache to use, which must outlive the client. Defaults to `asio_resolver_cache::instance()`.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         */
+        asio_stream_client& set_resolver_cache(asio_resolver_cache& cache)
+        {
+            resolver_cache = std::addressof(cache);
+            return *this;
+        }
+
+        /**
+         * @brief Set the socket options applied to every socket before it connects, buffer sizes included.
+         * @param value - The profile. The listener options are ignored, and `adaptive_cork` is taken by the session
+         *        built in the `bind_type::connect` handler, through `asio_stream_session::set_profile(client->get_profile())`.
+         * @return Returns a reference to the current `asio_stream_client` object to support chaining.
+         */
+        asio_stream_client& set_profile(const asio_socket_profile& value)
+        {
+            profile = value;
+            return *this;
+        }
+
+        const asio_socket_profile& get_profile() const noexcept
+        {
+            return profile;
+        }
+    private:
+        /**
+         * @brief Deadline of one connection attempt.
+         */
+        struct connect_deadline
+        {
+            explicit connect_deadline(asio_context& io_context, socket_type& stream_socket)
+                : sleep(io_context)
+                , stream_socket(stream_socket)
+                , done(false)
+                , expired(false)
+            {
+            }
+
+            asio_sleep                                  sleep;
+            socket_type&                                stream_socket;
+            std::atomic_bool                            done;
+            std::atomic_bool                            expired;
+        };
+
+        /**
+         * @brief Shared state of one happy eyeballs race.
+         */
+        struct connect_state
+        {
+            explicit connect_state(asio_context& io_context)
+                : wake(io_context)
+                , winner(std::numeric_limits<std::size_t>::max())
+                , failed(0)
+            {
+            }
+
+            asio_sleep                                  wake;
+            std::vector<std::unique_ptr<socket_type>>   sockets;
+            std::size_t                                 winner;
+            std::size_t                                 failed;
+            asio_error                                  ec;
+        };
+
+        /**
+         * @brief Order resolved endpoints by alternating address families.
+         * @param results - The resolved endpoints, in the order preferred by the system.
+         * @return Returns the endpoints, starting with the family of the first result.
+         */
+        static std::vector<endpoint_type> interleave(const std::vector<endpoint_type>& results)
+        {
+            std::vector<endpoint_type> primary, secondary, endpoints;
+
+            for (const auto& entry : results)
+            {
+                (primary.empty() || entry.protocol() == primary.front().protocol() ? primary : secondary).emplace_back(entry);
+            }
+
+            for (std::size_t i = 0; i < primary.size() || i < secondary.size(); ++i)
+            {
+                if (i < primary.size())
+                {
+                    endpoints.emplace_back(primary[i]);
+                }
+
+                if (i < secondary.size())
+                {
+                    endpoints.emplace_back(secondary[i]);
+                }
+            }
+
+            return endpoints;
+        }
+
+        /**
+         * @brief Coroutine handing the outcome of a connection attempt to `bind_type::connect`.
+         * @param stream_socket - The connected socket, or the socket of the failed attempt.
+         * @param ec - The error of the attempt, set to the handshake error if a secure handshake fails.
+         * @note A secure stream is handed out in place of the socket, after its handshake when the connect succeeded.
+         */
+        asio::awaitable<void> notify_connect(socket_type& stream_socket, asio_error& ec)
+        {
+            if constexpr (traits_type::secure)
+            {
+                Stream stream = traits_type::make(std::move(stream_socket), *stream_context);
+
+                if (!ec)
+                {
+                    if (ec = co_await traits_type::async_connect(stream, *stream_context), ec)
+                    {
+                        asio::error_code ignored;
+                        stream.lowest_layer().close(ignored);
+                        io_context.get_metrics().error(ec);
+                    }
+                    else
+                    {
+                        io_context.get_metrics().add(metric_type::handshakes);
+                        io_context.get_metrics().add(metric_type::resumptions, traits_type::resumed(stream) ? 1 : 0);
+                    }
+                }
+
+                co_await binder.async_notify(bind_type::connect, io_context, stream, ec);
+            }
+            else
+            {
+                co_await binder.async_notify(bind_type::connect, io_context, stream_socket, ec);
+            }
+        }
+
+        /**
+         * @brief Coroutine racing staggered connection attempts to several endpoints.
+         * @param endpoints - The endpoints to try, in order.
+         * @note The winning socket (or the last failed one) is handed to `bind_type::connect`, loser attempts are closed.
          */
-        asio::awaitable<void> connect_resolver(const asio_resolver::query& query)
+        asio::awaitable<void> connect_race(std::vector<endpoint_type> endpoints)
         {
             asio::error_code ec;
-            asio_resolver resolver(io_context);
+            std::shared_ptr<connect_state> state = std::make_shared<connect_state>(io_context);
 
             try
             {
-                for (auto& entry : co_await resolver.async_resolve(query,
-                                                                   asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))))
+                for (std::size_t i = 0; i < endpoints.size() && state->winner == std::numeric_limits<std::size_t>::max(); ++i)
                 {
-                    if (co_await connect(entry.endpoint()))
+                    co_await binder.async_notify(bind_type::init, io_context, *state->sockets.emplace_back(std::make_unique<socket_type>(io_context)));
+
+                    asio::co_spawn(io_context, connect_attempt(state, i, endpoints[i]), asio::bind_executor(io_strand, asio::detached));
+
+                    // Start the next attempt early if every attempt so far has already failed.
+                    if (i + 1 < endpoints.size() && state->failed < state->sockets.size())
                     {
-                        break;
+                        co_await state->wake.async_wait(connect_delay, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
                     }
                 }
+
+                while (state->winner == std::numeric_limits<std::size_t>::max() && state->failed < state->sockets.size())
+                {
+                    co_await state->wake.async_wait(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration::max()),
+                                                    asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+                }
+
+                for (std::size_t i = 0; i < state->sockets.size(); ++i)
+                {
+                    if (i != state->winner)
+                    {
+                        state->sockets[i]->close(ec);
+                    }
+                }
+
+                socket_type stream_socket(std::move(*state->sockets[state->winner == std::numeric_limits<std::size_t>::max() ? state->sockets.size() - 1 : state->winner]));
+                asio_error result = state->winner == std::numeric_limits<std::size_t>::max() ? state->ec : asio_error();
+
+                if (result == asio::error::timed_out)
+                {
+                    co_await binder.async_notify(bind_type::connect_timeout, io_context, stream_socket, result);
+                }
+
+                if (result)
+                {
+                    io_context.get_metrics().error(result);
+                }
+                else
+                {
+                    io_context.get_metrics().add(metric_type::connects);
+                }
+
+                co_await notify_connect(stream_socket, result);
             }
             catch (const std::exception&)
             {
 
             }
         }
+
+        /**
+         * @brief Coroutine running one attempt of a happy eyeballs race.
+         * @param state - The shared race state.
+         * @param i - The index of the attempt's socket in `state->sockets`.
+         * @param endpoint - The endpoint to connect to.
+         */
+        asio::awaitable<void> connect_attempt(std::shared_ptr<connect_state> state, std::size_t i, endpoint_type endpoint)
+        {
+            asio::error_code ec;
+
+            try
+            {
+                if (ec = co_await connect_socket(*state->sockets[i], endpoint), ec)
+                {
+                    state->failed++, state->ec = ec;
+                }
+                else if (state->winner == std::numeric_limits<std::size_t>::max())
+                {
+                    state->winner = i;
+                }
+                else
+                {
+                    state->sockets[i]->close(ec);
+                }
+
+                state->wake.cancel();
+            }
+            catch (const std::exception&)
+            {
+
+            }
+        }
+
+        /**
+         * @brief Coroutine to connect a socket under the connect deadline and concurrency limit.
+         * @param stream_socket - The socket to connect.
+         * @param endpoint - The remote endpoint to connect to.
+         * @return Returns the error of the attempt, `asio::error::timed_out` if the deadline expired first.
+         */
+        asio::awaitable<asio_error> connect_socket(socket_type& stream_socket, const endpoint_type& endpoint)
+        {
+            asio::error_code ec;
+            std::shared_ptr<connect_deadline> deadline;
+
+            co_await acquire_connect();
+
+            try
+            {
+                // Open the socket here rather than in async_connect, so the profile is set before the handshake.
+                if (!stream_socket.is_open() && (stream_socket.open(endpoint.protocol(), ec), ec))
+                {
+                    release_connect();
+                    co_return ec;
+                }
+
+                profile.apply(stream_socket);
+
+                if (connect_timeout.count() > 0)
+                {
+                    deadline = std::make_shared<connect_deadline>(io_context, stream_socket);
+                    asio::co_spawn(io_context, connect_watchdog(deadline), asio::bind_executor(io_strand, asio::detached));
+                }
+
+                co_await stream_socket.async_connect(endpoint,
+                                                     asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+
+                if (deadline)
+                {
+                    if (deadline->done.store(true), deadline->sleep.cancel(), deadline->expired.load())
+                    {
+                        ec = asio::error::timed_out;
+                    }
+                }
+            }
+            catch (const std::exception&)
+            {
+                ec = asio::error::operation_aborted;
+            }
+
+            release_connect();
+            co_return ec;
+        }
+
+        /**
+         * @brief Coroutine closing the socket of an attempt whose deadline expired.
+         * @param deadline - The deadline of the attempt.
+         */
+        asio::awaitable<void> connect_watchdog(std::shared_ptr<connect_deadline> deadline)
+        {
+            asio::error_code ec;
+
+            try
+            {
+                if (co_await deadline->sleep.async_wait(connect_timeout, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), !ec && !deadline->done.load())
+                {
+                    deadline->expired.store(true), deadline->stream_socket.close(ec);
+                }
+            }
+            catch (const std::exception&)
+            {
+
+            }
+        }
+
+        /**
+         * @brief Coroutine to wait for a free connect slot when a concurrency limit is set.
+         * @note A queued attempt is resumed by `release_connect` handing its slot over, there is nothing to poll.
+         */
+        asio::awaitable<void> acquire_connect()
+        {
+            if (connect_max == 0)
+            {
+                co_return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connect_mutex);
+
+                if (connect_cnt < connect_max)
+                {
+                    ++connect_cnt;
+                    co_return;
+                }
+            }
+
+            co_await asio::async_initiate<const asio::use_awaitable_t<>&, void()>([this] (auto handler)
+            {
+                auto resume = std::make_shared<decltype(handler)>(std::move(handler));
+                std::function<void()> wake = [resume]
+                {
+                    auto executor = asio::get_associated_executor(*resume);
+                    asio::post(executor, [resume] { std::move(*resume)(); });
+                };
+
+                {
+                    std::lock_guard<std::mutex> lock(connect_mutex);
+
+                    // Checked again, a slot may have been released since.
+                    if (connect_cnt >= connect_max)
+                    {
+                        connect_waiters.emplace_back(std::move(wake));
+                        return;
+                    }
+
+                    ++connect_cnt;
+                }
+
+                wake();
+            }, asio::use_awaitable);
+        }
+
+        /**
+         * @brief Release a connect slot, handing it over to the oldest queued attempt if any.
+         */
+        void release_connect()
+        {
+            std::function<void()> wake;
+
+            if (connect_max == 0)
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(connect_mutex);
+
+                if (connect_waiters.empty())
+                {
+                    connect_cnt = connect_cnt ? connect_cnt - 1 : 0;
+                    return;
+                }
+
+                wake = std::move(connect_waiters.front());
+                connect_waiters.pop_front();
+            }
+
+            wake();
+        }
     private:
         asio_context&                                   io_context;
         asio_binder&                                    binder;
         asio::strand<asio::io_context::executor_type>   io_strand;
+        std::chrono::milliseconds                       connect_delay;
+        std::chrono::milliseconds                       connect_timeout;
+        asio_backoff                                    backoff;
+        std::size_t                                     connect_max;
+        std::size_t                                     connect_cnt;
+        std::mutex                                      connect_mutex;
+        std::deque<std::function<void()>>               connect_waiters;                            // resume a queued attempt, its slot taken
+        asio_resolver_cache*                            resolver_cache;
+        context_type*                                   stream_context;
+        asio_socket_profile                             profile;
     };
+
+    using asio_tcp_client = asio_stream_client<asio::ip::tcp>;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    using asio_local_client = asio_stream_client<asio::local::stream_protocol>;
+#endif
 }
 
 #endif // __ASIO_TCP_CLIENT_H__
\ No newline at end of file
@@ -0,0 +1,417 @@
+﻿#ifndef __ASIO_TCP_POOL_H__
+#define __ASIO_TCP_POOL_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_backoff.hpp"
+#include "asio_context.hpp"
+#include "asio_context_thread_pool.hpp"
+#include "asio_observer.hpp"
+#include "asio_session.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace ik
+{
+    class asio_tcp_pool : public std::enable_shared_from_this<asio_tcp_pool>
+    {
+    public:
+        /**
+         * @brief A pooled connection to one endpoint.
+         * @note `inflight` counts the leases currently held on the connection, `failures` counts consecutive
+         *       failed leases. A slot is replaced lazily the next time it is selected while unhealthy, but not before
+         *       `retry_at` once a reconnect has failed.
+         */
+        struct slot
+        {
+            std::atomic<std::shared_ptr<asio_session>>  session;
+            std::atomic_size_t                          inflight{ 0 };
+            std::atomic_size_t                          failures{ 0 };
+            std::atomic_bool                            connecting{ false };
+            std::atomic_size_t                          attempts{ 0 };
+            std::atomic<std::int64_t>                   retry_at{ 0 };                      // steady clock ticks
+        };
+
+        /**
+         * @brief RAII handle on a pooled session, counted as one in-flight request until released.
+         */
+        class lease
+        {
+        public:
+            lease() = default;
+            explicit lease(const std::shared_ptr<slot>& ptr, const std::shared_ptr<asio_session>& session)
+                : ptr(ptr)
+                , session(session)
+            {
+            }
+            lease(lease&& other) noexcept
+                : ptr(std::move(other.ptr))
+                , session(std::move(other.session))
+            {
+            }
+            lease& operator=(lease&& other) noexcept
+            {
+                if (this != std::addressof(other))
+                {
+                    release(), ptr = std::move(other.ptr), session = std::move(other.session);
+                }
+
+                return *this;
+            }
+            ~lease()
+            {
+                release();
+            }
+        private:
+            lease(const lease&) = delete;
+            lease& operator=(const lease&) = delete;
+        public:
+            explicit operator bool() const noexcept
+            {
+                return session != nullptr;
+            }
+
+            asio_session* operator->() const noexcept
+            {
+                return session.get();
+            }
+
+            asio_session& operator*() const noexcept
+            {
+                return *session;
+            }
+
+            /**
+             * @brief Release the lease, marking the request as successful.
+             * @note A successful release resets the consecutive failure count of the slot.
+             */
+            void release() noexcept
+            {
+                if (ptr)
+                {
+                    ptr->failures.store(0, std::memory_order_relaxed);
+                    ptr->inflight.fetch_sub(1, std::memory_order_relaxed);
+                    ptr.reset(), session.reset();
+                }
+            }
+
+            /**
+             * @brief Release the lease, marking the request as failed.
+             * @note The slot becomes unhealthy once its consecutive failures reach the pool's `max_failures`.
+             */
+            void fail() noexcept
+            {
+                if (ptr)
+                {
+                    ptr->failures.fetch_add(1, std::memory_order_relaxed);
+                    ptr->inflight.fetch_sub(1, std::memory_order_relaxed);
+                    ptr.reset(), session.reset();
+                }
+            }
+        private:
+            std::shared_ptr<slot>                       ptr;
+            std::shared_ptr<asio_session>               session;
+        };
+    public:
+        explicit asio_tcp_pool(asio_context& io_context, asio_binder& binder, std::size_t max_failures = 3)
+            : io_context(io_context)
+            , binder(binder)
+            , io_group(io_context)
+            , io_strand(io_context.get_executor())
+            , max_failures(max_failures)
+            , index(0)
+        {
+
+        }
+        virtual ~asio_tcp_pool() = default;
+    public:
+        /**
+         * @brief Initialize the contexts the pooled sessions are spread across.
+         * @param ctx_cnt - The number of I/O contexts to initialize.
+         * @param thrd_cnt - The number of threads per context.
+         * @return Returns a reference to the current `asio_tcp_pool` object to support chaining.
+         */
+        asio_tcp_pool& init(std::size_t ctx_cnt, std::size_t thrd_cnt = 0)
+        {
+            io_group.init(ctx_cnt, thrd_cnt);
+            return *this;
+        }
+
+        /**
+         * @brief Add an event handler for a specific event type.
+         * @param e - The event type to bind the handler to.
+         * @param val - The handler function to be invoked when the event occurs.
+         * @return Returns a reference to the current `asio_tcp_pool` object to support chaining.
+         * @note Pooled sessions report `bind_type::recv`, `bind_type::writer` and `bind_type::disconnect` through the same binder.
+         *       `bind_type::connect` is notified with the `asio_socket` of every (re)connect attempt, as `asio_tcp_client`
+         *       does, failed ones included. The pool builds the session from a connected socket after the handler returns,
+         *       a handler moving the socket out takes the connection away from the pool.
+         */
+        template <typename F>
+        asio_tcp_pool& add(bind_type e, F&& val)
+        {
+            binder.add(e, std::forward<F>(val));
+            return *this;
+        };
+
+        /**
+         * @brief Set the backoff applied between failed reconnects of a slot.
+         * @param policy - The backoff policy; `policy.attempts` is ignored, slots are retried for as long as they are selected.
+         * @return Returns a reference to the current `asio_tcp_pool` object to support chaining.
+         */
+        asio_tcp_pool& set_reconnect(const asio_backoff& policy)
+        {
+            backoff = policy;
+            return *this;
+        }
+
+        /**
+         * @brief Open `n` warm connections to a remote server.
+         * @param address - The IP address of the remote server.
+         * @param port - The port number of the remote server.
+         * @param n - The number of connections to keep for the endpoint.
+         * @return Returns a reference to the current `asio_tcp_pool` object to support chaining.
+         */
+        asio_tcp_pool& async_connect(const std::string& address, std::uint16_t port, std::size_t n)
+        {
+            try
+            {
+                return async_connect(asio_endpoint(asio::ip::make_address(address), port), n);
+            }
+            catch (const std::exception&)
+            {
+
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Open `n` warm connections to a remote endpoint.
+         * @param endpoint - The remote endpoint to connect to.
+         * @param n - The number of connections to keep for the endpoint.
+         * @return Returns a reference to the current `asio_tcp_pool` object to support chaining.
+         * @note Each connection is placed on the least loaded context of the pool. Calling this again for the same endpoint
+         *       grows its slot list by `n`.
+         */
+        asio_tcp_pool& async_connect(const asio_endpoint& endpoint, std::size_t n)
+        {
+            std::vector<std::shared_ptr<slot>> added;
+
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                auto& slots = endpoints[endpoint];
+
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    added.emplace_back(slots.emplace_back(std::make_shared<slot>()));
+                }
+            }
+
+            for (const auto& ptr : added)
+            {
+                async_replace(endpoint, ptr);
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Lease the pooled session with the least in-flight requests.
+         * @param endpoint - The remote endpoint to lease a session for.
+         * @return Returns a `lease`, which is empty if no healthy connection is available for the endpoint.
+         * @note Unhealthy slots met during selection (closed, never connected or over `max_failures`) are replaced in the background.
+         */
+        lease acquire(const asio_endpoint& endpoint)
+        {
+            std::shared_ptr<slot> best;
+            std::shared_ptr<asio_session> best_session;
+            std::vector<std::shared_ptr<slot>> stale;
+
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+                auto iter = endpoints.find(endpoint);
+
+                if (iter == endpoints.end())
+                {
+                    return lease();
+                }
+
+                for (const auto& ptr : iter->second)
+                {
+                    std::shared_ptr<asio_session> session = ptr->session.load(std::memory_order_acquire);
+
+                    if (session == nullptr || !session->is_open() || ptr->failures.load(std::memory_order_relaxed) >= max_failures)
+                    {
+                        stale.emplace_back(ptr);
+                        continue;
+                    }
+
+                    if (best == nullptr || ptr->inflight.load(std::memory_order_relaxed) < best->inflight.load(std::memory_order_relaxed))
+                    {
+                        best = ptr, best_session = std::move(session);
+                    }
+                }
+            }
+
+            for (const auto& ptr : stale)
+            {
+                async_replace(endpoint, ptr);
+            }
+
+            if (best == nullptr)
+            {
+                return lease();
+            }
+
+            best->inflight.fetch_add(1, std::memory_order_relaxed);
+            return lease(best, best_session);
+        }
+
+        /**
+         * @brief Get the number of healthy connections kept for an endpoint.
+         * @param endpoint - The remote endpoint.
+         * @return Returns the number of open slots below the failure threshold.
+         */
+        std::size_t healthy(const asio_endpoint& endpoint)
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            auto iter = endpoints.find(endpoint);
+
+            if (iter == endpoints.end())
+            {
+                return 0;
+            }
+
+            return static_cast<std::size_t>(std::ranges::count_if(iter->second, [&] (const std::shared_ptr<slot>& ptr) {
+                std::shared_ptr<asio_session> session = ptr->session.load(std::memory_order_acquire);
+                return session != nullptr && session->is_open() && ptr->failures.load(std::memory_order_relaxed) < max_failures;
+            }));
+        }
+
+        /**
+         * @brief Close every pooled session and forget all endpoints.
+         * @note Reconnects still in flight close their session instead of installing it, the pool stays stopped.
+         */
+        void stop()
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+
+            stopped.store(true, std::memory_order_relaxed);
+
+            for (const auto& [endpoint, slots] : endpoints)
+            {
+                for (const auto& ptr : slots)
+                {
+                    if (std::shared_ptr<asio_session> session = ptr->session.exchange(nullptr); session)
+                    {
+                        session->close();
+                    }
+                }
+            }
+
+            endpoints.clear();
+        }
+    private:
+        /**
+         * @brief Spawn a replacement connection for a slot unless one is already in progress.
+         * @param endpoint - The remote endpoint of the slot.
+         * @param ptr - The slot to reconnect.
+         */
+        void async_replace(const asio_endpoint& endpoint, const std::shared_ptr<slot>& ptr)
+        {
+            if (stopped.load(std::memory_order_relaxed) || std::chrono::steady_clock::now().time_since_epoch().count() < ptr->retry_at.load(std::memory_order_relaxed) || ptr->connecting.exchange(true))
+            {
+                return;
+            }
+
+            try
+            {
+                asio::co_spawn(io_context, [self = this->shared_from_this(), endpoint, ptr] () -> asio::awaitable<void> {
+                    co_await self->replace(endpoint, ptr);
+                }, asio::bind_executor(io_strand, asio::detached));
+            }
+            catch (const std::exception&)
+            {
+                ptr->connecting.store(false);
+            }
+        }
+
+        /**
+         * @brief Coroutine to connect a slot and install a fresh session into it.
+         * @param endpoint - The remote endpoint of the slot.
+         * @param ptr - The slot to reconnect.
+         * @note The previous session of the slot, if any, is closed once the new one is installed. The install is done under
+         *       the pool lock, so a session connected after `stop` is closed rather than left in a forgotten slot.
+         */
+        asio::awaitable<void> replace(asio_endpoint endpoint, std::shared_ptr<slot> ptr)
+        {
+            asio::error_code ec;
+            asio_context& context = io_group.get_context();
+            asio_socket stream_socket(context);
+
+            try
+            {
+                if (co_await binder.async_notify(bind_type::init, context, stream_socket),
+                    co_await stream_socket.async_connect(endpoint,
+                                                         asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                {
+                    asio::error_code ignored;
+
+                    context.get_metrics().error(ec);
+                    stream_socket.close(ignored);
+                    ptr->retry_at.store((std::chrono::steady_clock::now() + backoff.delay(ptr->attempts.fetch_add(1))).time_since_epoch().count());
+                    co_await binder.async_notify(bind_type::connect, context, stream_socket, ec);
+                }
+                else if (co_await binder.async_notify(bind_type::connect, context, stream_socket, ec), stream_socket.is_open())
+                {
+                    std::shared_ptr<asio_session> session = std::make_shared<asio_session>(context, binder, stream_socket, index.fetch_add(1));
+                    std::shared_ptr<asio_session> previous;
+
+                    // A session never started is only held here, dropping it closes its socket.
+                    if (std::shared_lock<std::shared_mutex> lock(mutex); !stopped.load(std::memory_order_relaxed))
+                    {
+                        session->init(), previous = ptr->session.exchange(session, std::memory_order_acq_rel);
+                        ptr->failures.store(0, std::memory_order_relaxed), ptr->attempts.store(0), ptr->retry_at.store(0);
+                        context.get_metrics().add(metric_type::connects);
+                    }
+
+                    if (previous)
+                    {
+                        previous->close();
+                    }
+                }
+            }
+            catch (const std::exception&)
+            {
+
+            }
+
+            ptr->connecting.store(false);
+        }
+    private:
+        asio_context&                                                          io_context;
+        asio_binder&                                                           binder;
+        asio_context_thread_pool                                               io_group;
+        asio::strand<asio::io_context::executor_type>                          io_strand;
+        std::size_t                                                            max_failures;
+        asio_backoff                                                           backoff;
+        std::atomic_size_t                                                     index;
+        std::atomic_bool                                                       stopped{ false };
+        std::shared_mutex                                                      mutex;
+        std::map<asio_endpoint, std::vector<std::shared_ptr<slot>>>            endpoints;
+    };
+}
+
+#endif // __ASIO_TCP_POOL_H__
\ No newline at end of file
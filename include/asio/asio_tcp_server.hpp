@@ -48,23 +48,25 @@ namespace ik
     private:
         void init(asio_acceptor& acceptor)
         {
-            printf("server init\n");
+            ASIO_LOG_INFO("server init");
         }
 
         void stop(asio_acceptor& acceptor)
         {
-            printf("server stop\n");
+            ASIO_LOG_INFO("server stop");
         }
 
         void join(asio_context& context, asio_session& session, asio_error& ec)
         {
             assert(io_context.running_in_this_thread());
-            return asio::co_spawn(io_context, join_client(session, session.index()), asio::detached);
+
+            // The session only lives for the duration of the notification, take it over before returning.
+            sessions.emplace(session.index(), std::make_shared<asio_session>(std::move(session))).first->second->init();
         }
 
         void receive(asio_context& context, asio_session& session, const char* buf, std::size_t n)
         {
-            session.async_writer("123456\n");
+            session.async_writer(std::string_view(buf, n));
         }
 
         void leave(asio_context& context, asio_session& session, asio_error& ec)
@@ -74,12 +76,6 @@ namespace ik
         }
 
     private:
-        asio::awaitable<void> join_client(asio_session& session, std::size_t id)
-        {
-            co_await asio::this_coro::executor;
-            sessions.emplace(id, std::make_shared<asio_session>(std::move(session))).first->second->init();
-        }
-
         asio::awaitable<void> leave_client(std::size_t id)
         {
             co_await asio::this_coro::executor, sessions.erase(id);
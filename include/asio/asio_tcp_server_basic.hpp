@@ -7,37 +7,79 @@
 
 #include "asio_context.hpp"
 #include "asio_context_thread_pool.hpp"
+#include "asio_log.hpp"
 #include "asio_observer.hpp"
+#include "asio_rate_limit.hpp"
+#include "asio_session.hpp"
+#include "asio_socket_profile.hpp"
+#include "asio_trace.hpp"
 
 #include <asio.hpp>
 #include <memory>
 #include <atomic>
+#include <filesystem>
+#include <type_traits>
 
 namespace ik
 {
-    class asio_tcp_server_basic : public std::enable_shared_from_this<asio_tcp_server_basic>
+    /**
+     * @brief Accepts connections of a stream protocol and hands each one to the binder as a session.
+     * @tparam Protocol - The stream protocol, e.g. `asio::ip::tcp` (`asio_tcp_server_basic`) or `asio::local::stream_protocol` (`asio_local_server_basic`).
+     * @tparam Stream - The stream of the sessions, the protocol's socket or a TLS stream (`asio_ssl_server_basic`).
+     *         For a secure stream the handshake runs on the context of the new session, the accept loop moves on at once,
+     *         and `bind_type::accept` is only notified for connections whose handshake succeeded.
+     * @example
+     * auto server = std::make_shared<asio_local_server_basic>(io_context, binder);
+     * server->init(2).async_listen(asio_local_endpoint("/run/app/sidecar.sock"));
+     */
+    template <typename Protocol, typename Stream = typename Protocol::socket>
+    class asio_stream_server_basic : public std::enable_shared_from_this<asio_stream_server_basic<Protocol, Stream>>
     {
     public:
-        explicit asio_tcp_server_basic(asio_context& io_context, asio_binder& binder)
+        using protocol_type = Protocol;
+        using socket_type = typename Protocol::socket;
+        using endpoint_type = typename Protocol::endpoint;
+        using acceptor_type = typename Protocol::acceptor;
+        using session_type = asio_stream_session<Protocol, Stream>;
+        using traits_type = asio_stream_traits<Stream>;
+        using context_type = typename traits_type::context_type;
+    public:
+        explicit asio_stream_server_basic(asio_context& io_context, asio_binder& binder) requires (!traits_type::secure)
+            : io_context(io_context)
+            , binder(binder)
+            , acceptor(io_context)
+            , io_group(io_context)
+            , io_strand(io_context.get_executor())
+            , flag(1)
+            , stream_context(nullptr)
+        {
+
+        }
+        /**
+         * @param stream_context - The context of the secure streams, e.g. an `asio_ssl_context` holding the certificate
+         *        and the session cache. It must outlive the server.
+         */
+        explicit asio_stream_server_basic(asio_context& io_context, asio_binder& binder, context_type& stream_context) requires traits_type::secure
             : io_context(io_context)
             , binder(binder)
             , acceptor(io_context)
             , io_group(io_context)
             , io_strand(io_context.get_executor())
             , flag(1)
+            , stream_context(std::addressof(stream_context))
         {
 
         }
-        virtual ~asio_tcp_server_basic() = default;
+        virtual ~asio_stream_server_basic() = default;
     public:
         /**
          * @brief Initialize the TCP server with a specified number of I/O contexts and threads.
          * @param ctx_cnt - The number of I/O contexts to initialize.
          * @param thrd_cnt - The number of threads to initialize.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function initializes the I/O group with the specified number of contexts and threads.
          */
-        asio_tcp_server_basic& init(std::size_t ctx_cnt, std::size_t thrd_cnt = 0)
+        asio_stream_server_basic& init(std::size_t ctx_cnt, std::size_t thrd_cnt = 0)
         {
             io_group.init(ctx_cnt, thrd_cnt);
             return *this;
@@ -47,23 +89,47 @@ namespace ik
          * @brief Add an event handler for a specific event type.
          * @param e - The event type to bind the handler to.
          * @param val - The handler function to be invoked when the event occurs.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function binds a handler to a specific event type, which will be invoked when the event occurs.
          */
         template <typename F>
-        asio_tcp_server_basic& add(bind_type e, F&& val)
+        asio_stream_server_basic& add(bind_type e, F&& val)
         {
             binder.add(e, std::forward<F>(val));
             return *this;
         };
 
+        /**
+         * @brief Set the socket options of the listener and of the connections it accepts, before `async_listen`.
+         * @param value - The profile. `backlog`, `reuse_address` and `defer_accept` apply to the listener, the others
+         *        to every accepted socket, and `adaptive_cork` to the sessions handed to `bind_type::accept`.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
+         */
+        asio_stream_server_basic& set_profile(const asio_socket_profile& value)
+        {
+            profile = value;
+            return *this;
+        }
+
+        /**
+         * @brief Limit the rates of every session this server accepts, before `async_listen`.
+         * @param value - The rates of each session, see `asio_stream_session::set_rate_limit`. To cap the sessions of a
+         *        context together, set a budget on its limiter, e.g. for every context of `get_group()`.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
+         */
+        asio_stream_server_basic& set_rate_limit(const asio_rate_limit& value)
+        {
+            limit = value;
+            return *this;
+        }
+
         /**
          * @brief Start the TCP server to accept incoming connections on a specified port.
          * @param port - The port number to listen on. Default is 0, which means the OS will assign a port.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function spawns a coroutine to handle the asynchronous acceptance of connections.
          */
-        asio_tcp_server_basic& async_listen(std::uint16_t port = 0)
+        asio_stream_server_basic& async_listen(std::uint16_t port = 0) requires std::is_same_v<Protocol, asio::ip::tcp>
         {
             return async_listen(asio::ip::tcp::endpoint(asio::ip::tcp::v6(), port));
         }
@@ -72,10 +138,10 @@ namespace ik
          * @brief Start the TCP server to accept incoming connections on a specified address and port.
          * @param address - The IP address to listen on.
          * @param port - The port number to listen on. Default is 0, which means the OS will assign a port.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function spawns a coroutine to handle the asynchronous acceptance of connections.
          */
-        asio_tcp_server_basic& async_listen(const std::string_view& address, std::uint16_t port = 0)
+        asio_stream_server_basic& async_listen(const std::string_view& address, std::uint16_t port = 0) requires std::is_same_v<Protocol, asio::ip::tcp>
         {
             return async_listen(asio::ip::tcp::endpoint(asio::ip::make_address(address), port));
         }
@@ -84,10 +150,10 @@ namespace ik
          * @brief Start the TCP server to accept incoming connections using a specified protocol and port.
          * @param protocol - The protocol (IPv4 or IPv6) to use for the connection.
          * @param port - The port number to listen on. Default is 0, which means the OS will assign a port.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function spawns a coroutine to handle the asynchronous acceptance of connections.
          */
-        asio_tcp_server_basic& async_listen(const asio::ip::tcp& protocol, std::uint16_t port = 0)
+        asio_stream_server_basic& async_listen(const asio::ip::tcp& protocol, std::uint16_t port = 0) requires std::is_same_v<Protocol, asio::ip::tcp>
         {
             return async_listen(asio::ip::tcp::endpoint(protocol, port));
         }
@@ -95,12 +161,15 @@ namespace ik
         /**
          * @brief Start the TCP server to accept incoming connections on a specified endpoint.
          * @param endpoint - The endpoint (IP address and port) to listen on.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note This function spawns a coroutine to handle the asynchronous acceptance of connections.
+         *       For a Unix domain socket, a stale socket file left at the path by a previous run is removed first. A file
+         *       is only taken as stale when connecting to it is refused, one still served by another process is left alone
+         *       and the bind fails.
          */
-        asio_tcp_server_basic& async_listen(const asio::ip::tcp::endpoint& endpoint)
+        asio_stream_server_basic& async_listen(const endpoint_type& endpoint)
         {
-            asio::co_spawn(io_context, [self = shared_from_this(), endpoint] () -> asio::awaitable<void>
+            asio::co_spawn(io_context, [self = this->shared_from_this(), endpoint] () -> asio::awaitable<void>
             {
                 co_await self->listen(endpoint);
             }, asio::bind_executor(io_strand, asio::detached));
@@ -115,25 +184,45 @@ namespace ik
          *       It also handles exceptions that may occur during the listening process.
          *       The loop continues as long as the `flag` is set, and it stops when the acceptor is closed or an error occurs.
          */
-        asio::awaitable<void> listen(const asio::ip::tcp::endpoint& endpoint)
+        asio::awaitable<void> listen(const endpoint_type& endpoint)
         {
             try
             {
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+                if constexpr (std::is_same_v<Protocol, asio::local::stream_protocol>)
+                {
+                    if (std::error_code ec; !endpoint.path().empty() && endpoint.path().front() != '\0' && std::filesystem::is_socket(endpoint.path(), ec))
+                    {
+                        asio::error_code probe_ec, ignored;
+                        socket_type probe(io_context);
+
+                        if (co_await probe.async_connect(endpoint, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, probe_ec))),
+                            probe.close(ignored), probe_ec == asio::error::connection_refused)
+                        {
+                            std::filesystem::remove(endpoint.path(), ec);
+                        }
+                    }
+                }
+#endif
+
                 for (acceptor.open(endpoint.protocol()),
+                     profile.apply_listener(acceptor),
                      acceptor.bind(endpoint),
-                     acceptor.listen(),
-                     co_await binder.async_notify(bind_type::init, acceptor); acceptor.is_open(); co_await binder.async_notify(bind_type::stop, acceptor))
+                     acceptor.listen(profile.backlog),
+                     co_await binder.async_notify(bind_type::init, acceptor); acceptor.is_open(); )
                 {
                     for (; flag.load(); )
                     {
                         co_await async_accept(io_group.get_context());
                     }
+
+                    co_await binder.async_notify(bind_type::stop, acceptor);
                 }
             }
             catch (const std::exception& ec)
             {
                 // Log or handle exceptions that occur during connection acceptance.
-                printf("%s\n", ec.what());
+                ASIO_LOG_ERROR("%s", ec.what());
             }
         }
 
@@ -148,18 +237,38 @@ namespace ik
         asio::awaitable<void> async_accept(asio_context& context)
         {
             asio::error_code ec;
-            asio::ip::tcp::socket socket(context);
+            socket_type socket(context);
 
             try
             {
                 if (co_await acceptor.async_accept(socket, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
                 {
+                    if (ec != asio::error::operation_aborted)
+                    {
+                        io_context.get_metrics().error(ec);
+                    }
+
                     co_return socket.close();
                 }
 
                 if (acceptor.is_open() && socket.is_open())
                 {
-                    co_await binder.async_notify(bind_type::accept, context, asio_session(context, binder, socket, index.fetch_add(1)), ec);
+                    std::size_t id = index.fetch_add(1);
+                    context.get_metrics().add(metric_type::accepts);
+                    ASIO_TRACE(accept, id, 0);
+                    profile.apply(socket);
+
+                    if constexpr (traits_type::secure)
+                    {
+                        asio::co_spawn(context, [self = this->shared_from_this(), &context, socket = std::move(socket), id] () mutable
+                        {
+                            return self->handshake(context, std::move(socket), id);
+                        }, asio::detached);
+                    }
+                    else
+                    {
+                        co_await binder.async_notify(bind_type::accept, context, session_type(context, binder, socket, id).set_profile(profile).set_rate_limit(limit), ec);
+                    }
                 }
                 else
                 {
@@ -169,17 +278,59 @@ namespace ik
             catch (const std::exception& ec)
             {
                 // Log or handle exceptions that occur during connection acceptance.
-                printf("%s\n", ec.what());
+                ASIO_LOG_ERROR("%s", ec.what());
+            }
+        }
+
+        /**
+         * @brief Coroutine running the handshake of a secure stream on the context of the new session.
+         * @param context - The I/O context of the session, where the handshake runs.
+         * @param socket - The accepted socket, owned by the coroutine.
+         * @param id - The index of the session.
+         * @note On success the stream is handed back to the server's context and notified through `bind_type::accept`.
+         *       A failed handshake is counted as an error and the connection is dropped.
+         */
+        asio::awaitable<void> handshake(asio_context& context, socket_type socket, std::size_t id) requires traits_type::secure
+        {
+            asio::error_code ec;
+
+            try
+            {
+                std::shared_ptr<Stream> stream = std::make_shared<Stream>(traits_type::make(std::move(socket), *stream_context));
+
+                if (ec = co_await traits_type::async_accept(*stream, *stream_context), ec)
+                {
+                    if (ec != asio::error::operation_aborted)
+                    {
+                        context.get_metrics().error(ec);
+                    }
+
+                    stream->lowest_layer().close(ec);
+                    co_return;
+                }
+
+                context.get_metrics().add(metric_type::handshakes);
+                context.get_metrics().add(metric_type::resumptions, traits_type::resumed(*stream) ? 1 : 0);
+
+                asio::co_spawn(io_context, [self = this->shared_from_this(), &context, stream, id] () -> asio::awaitable<void>
+                {
+                    asio::error_code ec;
+                    co_await self->binder.async_notify(bind_type::accept, context, session_type(context, self->binder, *stream, id).set_profile(self->profile).set_rate_limit(self->limit), ec);
+                }, asio::detached);
+            }
+            catch (const std::exception& ec)
+            {
+                ASIO_LOG_ERROR("%s", ec.what());
             }
         }
     public:
         /**
          * @brief Stop the TCP server by closing the acceptor.
-         * @return Returns a reference to the current `asio_tcp_server_basic` object to support chaining.
+         * @return Returns a reference to the current `asio_stream_server_basic` object to support chaining.
          * @note If called from within the `io_context` thread, the acceptor is closed directly.
          *       Otherwise, the task is posted to the `io_context` to be executed later.
          */
-        asio_tcp_server_basic& stop()
+        asio_stream_server_basic& stop()
         {
             if (io_context.running_in_this_thread())
             {
@@ -193,15 +344,32 @@ namespace ik
 
             return *this;
         }
+
+        /**
+         * @brief Get the pool of contexts the accepted sessions run on, e.g. to `autoscale` it.
+         */
+        asio_context_thread_pool& get_group() noexcept
+        {
+            return io_group;
+        }
     private:
         asio_context&                                   io_context;
         asio_binder&                                    binder;
-        asio::ip::tcp::acceptor                         acceptor;
+        acceptor_type                                   acceptor;
         asio_context_thread_pool                        io_group;
         asio::strand<asio::io_context::executor_type>   io_strand;
         std::atomic_size_t                              flag;
         std::atomic_size_t                              index;
+        context_type*                                   stream_context;
+        asio_socket_profile                             profile;
+        asio_rate_limit                                 limit;
     };
+
+    using asio_tcp_server_basic = asio_stream_server_basic<asio::ip::tcp>;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    using asio_local_server_basic = asio_stream_server_basic<asio::local::stream_protocol>;
+#endif
 }
 
 #endif // __ASIO_TCP_SERVER_BASIC_H__
\ No newline at end of file
@@ -49,14 +49,14 @@ namespace ik
             
         };
     public:
-        template <typename Token = asio::default_completion_token_t<timer_type::executor_type>>
-        asio::awaitable<void> async_wait(const clock_type& expiry_time, Token&& token = asio::default_completion_token_t<timer_type::executor_type>())
+        template <typename Token = asio::default_completion_token_t<typename timer_type::executor_type>>
+        asio::awaitable<void> async_wait(const clock_type& expiry_time, Token&& token = asio::default_completion_token_t<typename timer_type::executor_type>())
         {
             timer_type::expires_after(expiry_time), co_await timer_type::async_wait(std::forward<Token>(token));
         }
 
-        template <typename Token = asio::default_completion_token_t<timer_type::executor_type>>
-        asio::awaitable<void> async_handler_wait(size_t expiry_time, Token&& token = asio::default_completion_token_t<timer_type::executor_type>())
+        template <typename Token = asio::default_completion_token_t<typename timer_type::executor_type>>
+        asio::awaitable<void> async_handler_wait(size_t expiry_time, Token&& token = asio::default_completion_token_t<typename timer_type::executor_type>())
         {
             co_await async_handler_wait(std::chrono::milliseconds(expiry_time), std::forward<Token>(token));
         }
@@ -67,16 +67,18 @@ namespace ik
         * @return Returns an `asio::awaitable<void>` that completes when the timer is stopped or canceled.
         * @note This coroutine continuously waits for the timer to expire and invokes a callback (`this_coro`) if provided.
         */
-        template <typename Token = asio::default_completion_token_t<timer_type::executor_type>>
-        asio::awaitable<void> async_handler_wait(const clock_type& expiry_time, Token&& token = asio::default_completion_token_t<timer_type::executor_type>())
+        template <typename Token = asio::default_completion_token_t<typename timer_type::executor_type>>
+        asio::awaitable<void> async_handler_wait(const clock_type& expiry_time, Token&& token = asio::default_completion_token_t<typename timer_type::executor_type>())
         {
-            for (timer_type::expires_after(expiry_time), state.store(true);
-                 state.load(); co_await timer_type::async_wait(std::forward<Token>(token)))
+            for (state.store(true); state.load();)
             {
                 if (handler != nullptr)
                 {
-                    co_await handler(std::forward<asio_timer_basic<timer_type>>(self));
+                    co_await handler(self);
                 }
+
+                // Re-arm on every pass, otherwise the timer stays expired and the loop spins.
+                timer_type::expires_after(expiry_time), co_await timer_type::async_wait(token);
             }
         }
 
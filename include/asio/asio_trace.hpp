@@ -0,0 +1,329 @@
+﻿#ifndef __ASIO_TRACE_H__
+#define __ASIO_TRACE_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#	include <intrin.h>
+#	define ASIO_TRACE_RDTSC() __rdtsc()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#	include <x86intrin.h>
+#	define ASIO_TRACE_RDTSC() __rdtsc()
+#endif
+
+#ifndef ASIO_EVENT_TRACE_CAPACITY
+#	define ASIO_EVENT_TRACE_CAPACITY 65536                                                         // events per thread, power of two
+#endif
+
+namespace ik
+{
+    /**
+     * @brief Places in the library that record trace events.
+     */
+    enum class trace_point : std::uint16_t
+    {
+        accept,                                                                                     // a = session id
+        read,                                                                                       // a = session id, b = bytes
+        dispatch,                                                                                   // a = bind_type, begin/end around the handler
+        enqueue,                                                                                    // a = session id, b = bytes
+        write,                                                                                      // a = session id, b = bytes
+        close,                                                                                      // a = session id
+        max
+    };
+
+    enum class trace_phase : std::uint16_t
+    {
+        instant,
+        begin,
+        end
+    };
+
+    /**
+     * @brief One binary trace record, also the on-disk format of `asio_trace::dump`.
+     */
+    struct asio_trace_event
+    {
+        std::uint64_t                                   ts;                                         // ticks in the ring, nanoseconds on disk
+        std::uint64_t                                   a;
+        std::uint64_t                                   b;
+        std::uint32_t                                   tid;
+        trace_point                                     point;
+        trace_phase                                     phase;
+    };
+
+    static_assert(sizeof(asio_trace_event) == 32, "asio_trace_event is written to disk as is");
+
+    /**
+     * @brief Fixed-size ring of trace events written by exactly one thread.
+     * @note The oldest events are overwritten once the ring is full. A dump taken while the thread is still
+     *       writing may contain a few torn records at the overwrite boundary.
+     */
+    class asio_trace_ring
+    {
+    public:
+        static constexpr std::size_t capacity = ASIO_EVENT_TRACE_CAPACITY;
+        static_assert((capacity & (capacity - 1)) == 0, "ASIO_EVENT_TRACE_CAPACITY must be a power of two");
+    public:
+        explicit asio_trace_ring(std::uint32_t tid)
+            : events(std::make_unique<asio_trace_event[]>(capacity))
+            , head(0)
+            , tid(tid)
+        {
+        }
+    public:
+        void push(std::uint64_t ts, trace_point point, trace_phase phase, std::uint64_t a, std::uint64_t b) noexcept
+        {
+            std::uint64_t h = head.load(std::memory_order_relaxed);
+            events[h & (capacity - 1)] = asio_trace_event{ ts, a, b, tid, point, phase };
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        void copy(std::vector<asio_trace_event>& out) const
+        {
+            std::uint64_t h = head.load(std::memory_order_acquire);
+
+            for (std::uint64_t i = h > capacity ? h - capacity : 0; i < h; ++i)
+            {
+                out.emplace_back(events[i & (capacity - 1)]);
+            }
+        }
+    private:
+        std::unique_ptr<asio_trace_event[]>             events;
+        std::atomic_uint64_t                            head;
+        std::uint32_t                                   tid;
+    };
+
+    /**
+     * @brief Process-wide trace collector.
+     * @note Each thread records into its own ring, registered on its first event, so recording takes no lock and
+     *       touches no shared cache line. Timestamps are raw TSC ticks where available and are converted to
+     *       nanoseconds when the rings are dumped. Use the `ASIO_TRACE` macros rather than calling `record`
+     *       directly, they compile to nothing unless `ASIO_EVENT_TRACE` is defined.
+     * @example
+     * // build with -DASIO_EVENT_TRACE, run the workload, then
+     * ik::asio_trace::dump("asio.trace");
+     * ik::asio_trace::convert("asio.trace", "asio.json");                                       // open in chrome://tracing or Perfetto
+     */
+    class asio_trace
+    {
+    public:
+        static void record(trace_point point, trace_phase phase, std::uint64_t a, std::uint64_t b) noexcept
+        {
+            thread_local asio_trace_ring* ring = attach();
+
+            if (ring != nullptr)
+            {
+                ring->push(ticks(), point, phase, a, b);
+            }
+        }
+
+        static void record(trace_point point, std::uint64_t a, std::uint64_t b) noexcept
+        {
+            record(point, trace_phase::instant, a, b);
+        }
+
+        /**
+         * @brief Write the events of every thread, ordered by time, to a binary file.
+         * @param path - The file to write.
+         * @return Returns `true` if the file was written, otherwise `false`.
+         * @note The file holds the 8-byte magic `ASIOTRC1`, a 64-bit event count and the `asio_trace_event` records.
+         */
+        static bool dump(const std::string& path)
+        {
+            std::vector<asio_trace_event> events = collect();
+            std::unique_ptr<FILE, decltype(&fclose)> file(fopen(path.c_str(), "wb"), &fclose);
+
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            std::uint64_t n = events.size();
+
+            return fwrite("ASIOTRC1", 1, 8, file.get()) == 8 &&
+                   fwrite(&n, sizeof(n), 1, file.get()) == 1 &&
+                   fwrite(events.data(), sizeof(asio_trace_event), events.size(), file.get()) == events.size();
+        }
+
+        /**
+         * @brief Convert a binary dump to the Chrome trace event JSON format, which Perfetto also reads.
+         * @param in - The file written by `dump`.
+         * @param out - The JSON file to write.
+         * @return Returns `true` if the file was converted, otherwise `false`.
+         */
+        static bool convert(const std::string& in, const std::string& out)
+        {
+            static const char* names[] = { "accept", "read", "dispatch", "enqueue", "write", "close" };
+            static const char* phases[] = { "i", "B", "E" };
+
+            std::unique_ptr<FILE, decltype(&fclose)> src(fopen(in.c_str(), "rb"), &fclose);
+            std::unique_ptr<FILE, decltype(&fclose)> dst(fopen(out.c_str(), "w"), &fclose);
+            char magic[8] = { 0 };
+            std::uint64_t n = 0;
+
+            if (src == nullptr || dst == nullptr || fread(magic, 1, 8, src.get()) != 8 || std::memcmp(magic, "ASIOTRC1", 8) != 0 || fread(&n, sizeof(n), 1, src.get()) != 1)
+            {
+                return false;
+            }
+
+            fprintf(dst.get(), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+            for (std::uint64_t i = 0; i < n; ++i)
+            {
+                asio_trace_event ev;
+
+                if (fread(&ev, sizeof(ev), 1, src.get()) != 1)
+                {
+                    return false;
+                }
+
+                std::size_t point = static_cast<std::size_t>(ev.point), phase = static_cast<std::size_t>(ev.phase);
+
+                fprintf(dst.get(), "%s\n{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"a\":%llu,\"b\":%llu}}",
+                        i ? "," : "",
+                        point < std::size(names) ? names[point] : "unknown",
+                        phase < std::size(phases) ? phases[phase] : "i",
+                        phase == 0 ? "\"s\":\"t\"," : "",
+                        static_cast<double>(ev.ts) / 1000.0, ev.tid,
+                        static_cast<unsigned long long>(ev.a), static_cast<unsigned long long>(ev.b));
+            }
+
+            fprintf(dst.get(), "\n]}\n");
+            return true;
+        }
+
+        /**
+         * @brief Copy the events of every thread, ordered by time, with timestamps in nanoseconds.
+         */
+        static std::vector<asio_trace_event> collect()
+        {
+            std::vector<asio_trace_event> events;
+            asio_trace& self = instance();
+
+            {
+                std::unique_lock<std::mutex> lock(self.mutex);
+
+                for (const auto& ring : self.rings)
+                {
+                    ring->copy(events);
+                }
+            }
+
+            // Convert ticks to nanoseconds with the rate measured between the first event and now.
+            std::uint64_t tick = ticks();
+            std::int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - self.origin_time).count();
+            double ns_per_tick = tick > self.origin_tick && elapsed > 0 ? static_cast<double>(elapsed) / static_cast<double>(tick - self.origin_tick) : 1.0;
+
+            for (asio_trace_event& ev : events)
+            {
+                ev.ts = ev.ts > self.origin_tick ? static_cast<std::uint64_t>(static_cast<double>(ev.ts - self.origin_tick) * ns_per_tick) : 0;
+            }
+
+            std::stable_sort(events.begin(), events.end(), [] (const asio_trace_event& l, const asio_trace_event& r) {
+                return l.ts < r.ts;
+            });
+
+            return events;
+        }
+    private:
+        asio_trace()
+            : origin_tick(ticks())
+            , origin_time(std::chrono::steady_clock::now())
+        {
+        }
+
+        static asio_trace& instance()
+        {
+            static asio_trace trace;
+            return trace;
+        }
+
+        static std::uint64_t ticks() noexcept
+        {
+#if defined(ASIO_TRACE_RDTSC)
+            return ASIO_TRACE_RDTSC();
+#else
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        /**
+         * @brief Create and register the ring of the calling thread. Rings outlive their threads so a dump still sees them.
+         */
+        static asio_trace_ring* attach() noexcept
+        {
+            try
+            {
+                asio_trace& self = instance();
+                std::unique_lock<std::mutex> lock(self.mutex);
+                return self.rings.emplace_back(std::make_unique<asio_trace_ring>(static_cast<std::uint32_t>(self.rings.size() + 1))).get();
+            }
+            catch (const std::exception&)
+            {
+                return nullptr;
+            }
+        }
+    private:
+        std::uint64_t                                                          origin_tick;
+        std::chrono::steady_clock::time_point                                  origin_time;
+        std::mutex                                                             mutex;
+        std::vector<std::unique_ptr<asio_trace_ring>>                          rings;
+    };
+
+    /**
+     * @brief Records a begin event on construction and the matching end event on destruction.
+     */
+    class asio_trace_scope
+    {
+    public:
+        asio_trace_scope(trace_point point, std::uint64_t a, std::uint64_t b) noexcept
+            : point(point)
+            , a(a)
+        {
+            asio_trace::record(point, trace_phase::begin, a, b);
+        }
+        ~asio_trace_scope()
+        {
+            asio_trace::record(point, trace_phase::end, a, 0);
+        }
+    private:
+        asio_trace_scope(const asio_trace_scope&) = delete;
+        asio_trace_scope& operator=(const asio_trace_scope&) = delete;
+    private:
+        trace_point                                     point;
+        std::uint64_t                                   a;
+    };
+}
+
+#define ASIO_TRACE_CONCAT_IMPL(a, b) a##b
+#define ASIO_TRACE_CONCAT(a, b) ASIO_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * @brief Tracepoints, compiled in only when `ASIO_EVENT_TRACE` is defined. The arguments are not evaluated otherwise.
+ * @example
+ * ASIO_TRACE(read, id, n);                                                                        // instant event
+ * ASIO_TRACE_SCOPE(dispatch, static_cast<std::uint64_t>(type), 0);                                // begin/end around the scope
+ */
+#if defined(ASIO_EVENT_TRACE)
+#	define ASIO_TRACE(point, a, b) ::ik::asio_trace::record(::ik::trace_point::point, static_cast<std::uint64_t>(a), static_cast<std::uint64_t>(b))
+#	define ASIO_TRACE_SCOPE(point, a, b) ::ik::asio_trace_scope ASIO_TRACE_CONCAT(asio_trace_scope_, __LINE__)(::ik::trace_point::point, static_cast<std::uint64_t>(a), static_cast<std::uint64_t>(b))
+#else
+#	define ASIO_TRACE(point, a, b) ((void)0)
+#	define ASIO_TRACE_SCOPE(point, a, b) ((void)0)
+#endif
+
+#endif // __ASIO_TRACE_H__
\ No newline at end of file
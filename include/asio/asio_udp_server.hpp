@@ -0,0 +1,188 @@
+﻿#ifndef __ASIO_UDP_SERVER_H__
+#define __ASIO_UDP_SERVER_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_context_thread_pool.hpp"
+#include "asio_log.hpp"
+#include "asio_observer.hpp"
+#include "asio_udp_session.hpp"
+
+#include <asio.hpp>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace ik
+{
+    /**
+     * @brief UDP server spreading one port over the contexts of a pool.
+     * @note With `SO_REUSEPORT` (the default where the platform has it) every context binds its own socket to the port
+     *       and the kernel spreads the peers across them, so each context receives and sends without sharing a socket.
+     *       Without it a single socket on the first context serves the port. Each socket is an `asio_udp_session`,
+     *       see there for the binder events.
+     * @example
+     * auto server = std::make_shared<asio_udp_server>(io_context, binder);
+     * server->init(4).async_listen(9000);
+     */
+    class asio_udp_server : public std::enable_shared_from_this<asio_udp_server>
+    {
+    public:
+        explicit asio_udp_server(asio_context& io_context, asio_binder& binder)
+            : io_context(io_context)
+            , binder(binder)
+            , io_group(io_context)
+#if defined(SO_REUSEPORT)
+            , reuse_port(true)
+#else
+            , reuse_port(false)
+#endif
+            , datagram_size(2048)
+        {
+        }
+        virtual ~asio_udp_server() = default;
+    public:
+        /**
+         * @brief Initialize the server with a specified number of I/O contexts and threads.
+         * @param ctx_cnt - The number of I/O contexts, i.e. sockets when `SO_REUSEPORT` is used.
+         * @param thrd_cnt - The number of threads per context.
+         * @return Returns a reference to the current `asio_udp_server` object to support chaining.
+         */
+        asio_udp_server& init(std::size_t ctx_cnt, std::size_t thrd_cnt = 0)
+        {
+            io_group.init(ctx_cnt, thrd_cnt);
+            return *this;
+        }
+
+        template <typename F>
+        asio_udp_server& add(bind_type e, F&& val)
+        {
+            binder.add(e, std::forward<F>(val));
+            return *this;
+        }
+
+        /**
+         * @brief Choose between one socket per context (`SO_REUSEPORT`) and a single socket. Call before `async_listen`.
+         * @note Ignored where the platform has no `SO_REUSEPORT`.
+         */
+        asio_udp_server& set_reuse_port(bool enable) noexcept
+        {
+#if defined(SO_REUSEPORT)
+            reuse_port = enable;
+#endif
+            return *this;
+        }
+
+        /**
+         * @brief Set the largest datagram received whole. Call before `async_listen`.
+         */
+        asio_udp_server& set_datagram_size(std::size_t n) noexcept
+        {
+            datagram_size = n;
+            return *this;
+        }
+
+        asio_udp_server& async_listen(std::uint16_t port = 0)
+        {
+            return async_listen(asio_udp_endpoint(asio::ip::udp::v6(), port));
+        }
+
+        asio_udp_server& async_listen(const std::string_view& address, std::uint16_t port = 0)
+        {
+            return async_listen(asio_udp_endpoint(asio::ip::make_address(address), port));
+        }
+
+        /**
+         * @brief Bind the sockets to an endpoint and start receiving.
+         * @param endpoint - The endpoint to bind. With port 0 the port chosen for the first socket is reused by the others.
+         * @return Returns a reference to the current `asio_udp_server` object to support chaining.
+         * @note Failures are logged and counted on the parent context, sockets bound before the failure keep running.
+         */
+        asio_udp_server& async_listen(const asio_udp_endpoint& endpoint)
+        {
+            std::size_t cnt = reuse_port ? (io_group.size() != 0 ? io_group.size() : 1) : 1;
+            asio_udp_endpoint local = endpoint;
+
+            for (std::size_t i = 0; i < cnt; ++i)
+            {
+                try
+                {
+                    asio_context& context = io_group.size() != 0 ? io_group.get_context(i) : io_context;
+                    asio_udp_socket socket(context);
+
+                    socket.open(local.protocol());
+#if defined(SO_REUSEPORT)
+                    if (reuse_port)
+                    {
+                        socket.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+                    }
+#endif
+                    socket.bind(local);
+                    local = socket.local_endpoint();
+
+                    auto session = std::make_shared<asio_udp_session>(context, binder, socket, sessions.size(), datagram_size);
+                    sessions.emplace_back(session)->init();
+                }
+                catch (const asio::system_error& ex)
+                {
+                    io_context.get_metrics().error(ex.code());
+                    ASIO_LOG_ERROR("%s", ex.what());
+                    break;
+                }
+                catch (const std::exception& ex)
+                {
+                    ASIO_LOG_ERROR("%s", ex.what());
+                    break;
+                }
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Close every socket of the server.
+         */
+        asio_udp_server& stop()
+        {
+            for (const auto& session : sessions)
+            {
+                session->close();
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Get the sockets of the server, one per context with `SO_REUSEPORT`, otherwise one.
+         */
+        const std::vector<std::shared_ptr<asio_udp_session>>& get_sessions() const noexcept
+        {
+            return sessions;
+        }
+
+        /**
+         * @brief Get the endpoint the server is bound to, e.g. to learn the port chosen for port 0.
+         */
+        asio_udp_endpoint local_endpoint() const
+        {
+            return sessions.empty() ? asio_udp_endpoint() : sessions.front()->local_endpoint();
+        }
+
+        asio_context_thread_pool& get_group() noexcept
+        {
+            return io_group;
+        }
+    private:
+        asio_context&                                   io_context;
+        asio_binder&                                    binder;
+        asio_context_thread_pool                        io_group;
+        bool                                            reuse_port;
+        std::size_t                                     datagram_size;
+        std::vector<std::shared_ptr<asio_udp_session>>  sessions;
+    };
+}
+
+#endif // __ASIO_UDP_SERVER_H__
\ No newline at end of file
@@ -0,0 +1,370 @@
+﻿#ifndef __ASIO_UDP_SESSION_H__
+#define __ASIO_UDP_SESSION_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_log.hpp"
+#include "asio_metrics.hpp"
+#include "asio_observer.hpp"
+#include "asio_trace.hpp"
+#include "asio_utils.hpp"
+
+#include <asio.hpp>
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#	include <sys/socket.h>
+#	include <sys/uio.h>
+#endif
+
+namespace ik
+{
+    /**
+     * @brief A bound UDP socket on one context, with batched receive and send.
+     * @note On Linux datagrams are read with `recvmmsg` and written with `sendmmsg`, up to `batch_cnt` per system call,
+     *       elsewhere one at a time. Every datagram is reported through the binder:
+     *       - `bind_type::recv` as `(asio_context&, asio_udp_session&, asio_udp_endpoint& from, const char* buf, std::size_t n)`
+     *       - `bind_type::send` once per batch as `(asio_context&, asio_udp_session&, std::size_t bytes, asio_error& ec)`
+     *       These signatures differ from the TCP ones, so give UDP endpoints their own `asio_binder`.
+     * @example
+     * binder.add(bind_type::recv, [] (asio_context& context, asio_udp_session& session, asio_udp_endpoint& from, const char* buf, std::size_t n) {
+     *     session.async_send_to(from, std::string_view(buf, n));                               // echo
+     * });
+     */
+    class asio_udp_session : public std::enable_shared_from_this<asio_udp_session>
+    {
+    public:
+        static constexpr std::size_t batch_cnt = 64;
+    public:
+        /**
+         * @param datagram_size - The largest datagram that is received whole, longer ones are truncated and counted as errors.
+         */
+        explicit asio_udp_session(asio_context& io_context, asio_binder& binder, asio_udp_socket& socket, std::size_t id, std::size_t datagram_size = 2048)
+            : self(std::ref(*this))
+            , io_context(io_context)
+            , io_strand(io_context.get_executor())
+            , binder(binder)
+            , socket(std::move(socket))
+            , id(id)
+            , datagram_size(datagram_size)
+            , buffers(batch_cnt * datagram_size)
+            , flushing(false)
+        {
+        }
+        virtual ~asio_udp_session()
+        {
+            if (!io_msdeque.empty())
+            {
+                io_context.get_metrics().add(metric_type::queue_depth, -static_cast<std::int64_t>(io_msdeque.size()));
+            }
+        }
+    private:
+        asio_udp_session(const asio_udp_session&) = delete;
+        asio_udp_session& operator=(const asio_udp_session&) = delete;
+    public:
+        asio_udp_session& init()
+        {
+            // throws an exception if the socket's thread is not in the same thread as the current object io_context.
+            if (std::addressof(asio::query(socket.get_executor(), asio::execution::context)) != std::addressof(io_context))
+            {
+                throw asio::error_code(asio::error::operation_aborted);
+            }
+
+            socket.non_blocking(true);
+
+            io_context.dispatch([&]
+            {
+                try
+                {
+                    asio::co_spawn(io_context, [self = this->shared_from_this()] { return self->reader(); }, asio::bind_executor(io_strand, asio::detached));
+                    io_context.get_metrics().add(metric_type::sessions);
+                }
+                catch (const std::exception&)
+                {
+                }
+            });
+
+            return *this;
+        }
+
+        /**
+         * @brief Queue a datagram to be sent to `endpoint`.
+         * @param endpoint - The destination.
+         * @param buffer - The payload, copied into the queue.
+         * @note All datagrams queued during one turn of the context go out together, in as few `sendmmsg` calls as possible.
+         *       Datagrams that cannot be sent (e.g. too large) are dropped and counted as errors.
+         */
+        asio_udp_session& async_send_to(const asio_udp_endpoint& endpoint, const std::string_view& buffer)
+        {
+            if (io_context.running_in_this_thread())
+            {
+                if (socket.is_open())
+                {
+                    io_msdeque.emplace_back(endpoint, std::string(buffer));
+                    io_context.get_metrics().add(metric_type::queue_depth);
+                    ASIO_TRACE(enqueue, id, buffer.size());
+
+                    if (!std::exchange(flushing, true))
+                    {
+                        io_context.post([self = this->shared_from_this()] { self->flush(); });
+                    }
+                }
+            }
+            else
+            {
+                io_context.dispatch([self = this->shared_from_this(), endpoint, data = std::string(buffer)] { self->async_send_to(endpoint, data); });
+            }
+
+            return *this;
+        }
+
+        std::size_t index() const
+        {
+            return id;
+        }
+
+        bool is_open() const
+        {
+            return socket.is_open();
+        }
+
+        asio_udp_endpoint local_endpoint() const
+        {
+            asio::error_code ec;
+            return socket.local_endpoint(ec);
+        }
+
+        /**
+        * @brief Close the socket.
+        * @note If the function is called from within the `io_context` thread, it directly closes the socket.
+        *       Otherwise, it posts the task to the `io_context` to be executed later.
+        */
+        void close()
+        {
+            asio::error_code ec;
+
+            try
+            {
+                if (io_context.running_in_this_thread())
+                {
+                    if (socket.is_open())
+                    {
+                        ASIO_TRACE(close, id, 0);
+                        socket.close(ec);
+                    }
+                }
+                else
+                {
+                    io_context.dispatch([self = this->shared_from_this()] { self->close(); });
+                }
+            }
+            catch (const std::exception&)
+            {
+                // Exception handling (e.g., logging) can be added here.
+            }
+        }
+    private:
+        /**
+         * @brief Coroutine to receive datagrams until the socket is closed.
+         * @note Waits for the socket to become readable, then drains it in batches so a burst costs one wakeup.
+         */
+        asio::awaitable<void> reader()
+        {
+            asio::error_code ec;
+
+            try
+            {
+#if defined(__linux__)
+                std::array<mmsghdr, batch_cnt> hdrs{};
+                std::array<iovec, batch_cnt> iovs{};
+                std::array<asio_udp_endpoint, batch_cnt> from{};
+
+                for (std::size_t i = 0; i < batch_cnt; ++i)
+                {
+                    iovs[i].iov_base = buffers.data() + i * datagram_size;
+                    iovs[i].iov_len = datagram_size;
+                    hdrs[i].msg_hdr.msg_iov = &iovs[i];
+                    hdrs[i].msg_hdr.msg_iovlen = 1;
+                    hdrs[i].msg_hdr.msg_name = from[i].data();
+                }
+
+                for (; socket.is_open(); )
+                {
+                    if (co_await socket.async_wait(asio::socket_base::wait_read, asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec))), ec)
+                    {
+                        break;
+                    }
+
+                    for (int n = static_cast<int>(batch_cnt); n == static_cast<int>(batch_cnt) && socket.is_open(); )
+                    {
+                        for (std::size_t i = 0; i < batch_cnt; ++i)
+                        {
+                            hdrs[i].msg_hdr.msg_namelen = static_cast<socklen_t>(from[i].capacity());
+                        }
+
+                        if ((n = ::recvmmsg(socket.native_handle(), hdrs.data(), static_cast<unsigned int>(batch_cnt), MSG_DONTWAIT, nullptr)) < 0)
+                        {
+                            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                            {
+                                io_context.get_metrics().error(asio::error_code(errno, asio::error::get_system_category()));
+                            }
+
+                            break;
+                        }
+
+                        for (int i = 0; i < n; ++i)
+                        {
+                            from[i].resize(hdrs[i].msg_hdr.msg_namelen);
+
+                            if ((hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0)
+                            {
+                                io_context.get_metrics().error(asio::error::message_size);
+                            }
+
+                            received(from[i], buffers.data() + i * datagram_size, hdrs[i].msg_len);
+                        }
+                    }
+                }
+#else
+                for (asio_udp_endpoint endpoint; socket.is_open(); )
+                {
+                    std::size_t n = co_await socket.async_receive_from(asio::buffer(buffers.data(), datagram_size), endpoint,
+                                                                       asio::bind_executor(io_strand, asio::redirect_error(asio::use_awaitable, ec)));
+
+                    if (ec && ec != asio::error::message_size)
+                    {
+                        if (ec == asio::error::operation_aborted)
+                        {
+                            break;
+                        }
+
+                        io_context.get_metrics().error(ec);
+                        continue;
+                    }
+
+                    received(endpoint, buffers.data(), n);
+                }
+#endif
+            }
+            catch (const std::exception& ex)
+            {
+                ASIO_LOG_ERROR("%s", ex.what());
+            }
+
+            io_context.get_metrics().add(metric_type::sessions, -1);
+        }
+
+        void received(asio_udp_endpoint& endpoint, const char* buf, std::size_t n)
+        {
+            io_context.get_metrics().add(metric_type::bytes_in, static_cast<std::int64_t>(n));
+            io_context.get_metrics().add(metric_type::messages_in);
+            ASIO_TRACE(read, id, n);
+            binder.notify(bind_type::recv, io_context, self, endpoint, buf, n);
+        }
+
+        /**
+         * @brief Send the queued datagrams, waiting for the socket to become writable if its buffer is full.
+         */
+        void flush()
+        {
+            asio::error_code ec, last;
+            std::size_t bytes = 0, cnt = 0, popped = 0;
+            bool blocked = false;
+
+            while (!io_msdeque.empty() && socket.is_open())
+            {
+                std::size_t sent = 0;
+#if defined(__linux__)
+                std::array<mmsghdr, batch_cnt> hdrs{};
+                std::array<iovec, batch_cnt> iovs{};
+                std::size_t k = 0;
+
+                for (auto it = io_msdeque.begin(); it != io_msdeque.end() && k < batch_cnt; ++it, ++k)
+                {
+                    iovs[k].iov_base = it->second.data();
+                    iovs[k].iov_len = it->second.size();
+                    hdrs[k].msg_hdr.msg_iov = &iovs[k];
+                    hdrs[k].msg_hdr.msg_iovlen = 1;
+                    hdrs[k].msg_hdr.msg_name = it->first.data();
+                    hdrs[k].msg_hdr.msg_namelen = static_cast<socklen_t>(it->first.size());
+                }
+
+                if (int n = ::sendmmsg(socket.native_handle(), hdrs.data(), static_cast<unsigned int>(k), MSG_DONTWAIT); n < 0)
+                {
+                    ec.assign(errno, asio::error::get_system_category());
+                }
+                else
+                {
+                    for (sent = static_cast<std::size_t>(n); n-- > 0; )
+                    {
+                        bytes += hdrs[n].msg_len;
+                    }
+                }
+#else
+                if (std::size_t n = socket.send_to(asio::buffer(io_msdeque.front().second), io_msdeque.front().first, 0, ec); !ec)
+                {
+                    bytes += n, sent = 1;
+                }
+#endif
+                for (std::size_t i = 0; i < sent; ++i)
+                {
+                    ASIO_TRACE(write, id, io_msdeque.front().second.size());
+                    io_msdeque.pop_front();
+                }
+
+                cnt += sent, popped += sent;
+
+                if (ec == asio::error::would_block || ec == asio::error::try_again)
+                {
+                    blocked = true;
+                    socket.async_wait(asio::socket_base::wait_write, asio::bind_executor(io_strand, [self = this->shared_from_this()] (const asio::error_code&) {
+                        self->flush();
+                    }));
+                    break;
+                }
+
+                if (ec && ec != asio::error::interrupted)
+                {
+                    // The datagram at the front is rejected by the kernel, drop it instead of retrying forever.
+                    io_context.get_metrics().error(ec);
+                    io_msdeque.pop_front();
+                    last = ec, ++popped;
+                }
+
+                ec.clear();
+            }
+
+            flushing = blocked;
+
+            io_context.get_metrics().add(metric_type::queue_depth, -static_cast<std::int64_t>(popped));
+            io_context.get_metrics().add(metric_type::bytes_out, static_cast<std::int64_t>(bytes));
+            io_context.get_metrics().add(metric_type::messages_out, static_cast<std::int64_t>(cnt));
+
+            if (popped != 0)
+            {
+                binder.notify(bind_type::send, io_context, self, bytes, last);
+            }
+        }
+    private:
+        asio_udp_session&                                          self;
+        asio_context&                                              io_context;
+        asio::strand<asio::io_context::executor_type>              io_strand;
+        asio_binder&                                               binder;
+        asio_udp_socket                                            socket;
+        std::size_t                                                id;
+        std::size_t                                                datagram_size;
+        std::vector<char>                                          buffers;
+        std::deque<std::pair<asio_udp_endpoint, std::string>>      io_msdeque;
+        bool                                                       flushing;
+    };
+}
+
+#endif // __ASIO_UDP_SESSION_H__
\ No newline at end of file
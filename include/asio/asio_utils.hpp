@@ -16,6 +16,15 @@ namespace ik
     using asio_endpoint = asio::ip::tcp::endpoint;
     using asio_resolver = asio::ip::tcp::resolver;
 
+    using asio_udp_socket = asio::ip::udp::socket;
+    using asio_udp_endpoint = asio::ip::udp::endpoint;
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+    using asio_local_acceptor = asio::local::stream_protocol::acceptor;
+    using asio_local_socket = asio::local::stream_protocol::socket;
+    using asio_local_endpoint = asio::local::stream_protocol::endpoint;
+#endif
+
     using asio_error = asio::error_code;
 
     struct asio_buf_t
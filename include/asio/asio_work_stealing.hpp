@@ -0,0 +1,385 @@
+﻿#ifndef __ASIO_WORK_STEALING_H__
+#define __ASIO_WORK_STEALING_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include "asio_context.hpp"
+#include "asio_context_thread_pool.hpp"
+#include "asio_log.hpp"
+
+#include <asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace ik
+{
+    /**
+     * @brief Runs tasks not bound to a socket's ordering on the contexts of a pool, moving queued work to idle contexts.
+     * @note Every context of the pool has its own deque. A task posted from a context's thread goes to that context,
+     *       which runs its own tasks newest first while they are hot in cache. Any other task is spread round-robin.
+     *       Once a deque holds a backlog, an idle sibling is woken and steals the older half of the largest deque,
+     *       so a CPU-bound burst spreads over the cores. The tasks run between the contexts' I/O handlers in slices
+     *       of `batch`, so stealing does not starve the sessions pinned to a context. Tasks run in no particular order.
+     *       Create it with `std::make_shared` once the pool is initialized, pending runs keep it alive.
+     *       It follows an autoscaling pool: a context added later gets a deque, and a context about to be retired
+     *       takes no new task, while the tasks already queued on it still run before its thread ends.
+     * @example
+     * auto executor = std::make_shared<asio_work_stealing_executor>(pool);
+     * binder.add(bind_type::recv, [&](asio_context&, asio_session& session, const char* data, std::size_t n)
+     * {
+     *     executor->post([request = std::string(data, n)] { process(request); });
+     * });
+     */
+    class asio_work_stealing_executor : public std::enable_shared_from_this<asio_work_stealing_executor>
+    {
+    public:
+        using task_type = std::function<void()>;
+    public:
+        explicit asio_work_stealing_executor(asio_context_thread_pool& pool, std::size_t batch = 64)
+            : pool(pool)
+            , batch(batch ? batch : 1)
+            , next(0)
+            , executed(0)
+            , stolen(0)
+        {
+            key = pool.watch([this] (asio_context& context, bool joined) { this->update(context, joined); });
+        }
+        virtual ~asio_work_stealing_executor()
+        {
+            pool.unwatch(key);
+        }
+    private:
+        asio_work_stealing_executor(const asio_work_stealing_executor&) = delete;
+        asio_work_stealing_executor& operator=(const asio_work_stealing_executor&) = delete;
+    public:
+        /**
+         * @brief Queue a task, on the calling context if it belongs to the pool.
+         * @param task - The task. An exception it throws is logged and does not stop the context.
+         * @return Returns a reference to the current `asio_work_stealing_executor` object to support chaining.
+         * @note Without any context in the pool, the task is posted to the pool's parent context.
+         */
+        template <typename F>
+        asio_work_stealing_executor& post(F&& task)
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            if (members.empty())
+            {
+                asio::post(pool.get_context(), task_type(std::forward<F>(task)));
+                return *this;
+            }
+
+            std::size_t i = local();
+            std::size_t depth = 0;
+
+            if (i == queues.size() || !queues[i]->live)
+            {
+                i = members[next.fetch_add(1, std::memory_order_relaxed) % members.size()];
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(queues[i]->mutex);
+                queues[i]->tasks.emplace_back(std::forward<F>(task));
+                depth = queues[i]->depth.fetch_add(1, std::memory_order_release) + 1;
+            }
+
+            wake(i);
+
+            // A backlog builds up, let an idle sibling take part of it.
+            if (depth > 1)
+            {
+                wake_idle(i);
+            }
+
+            return *this;
+        }
+
+        /**
+         * @brief Get the number of tasks queued and not yet started.
+         */
+        std::size_t pending() const
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            std::size_t n = 0;
+
+            for (const auto& queue : queues)
+            {
+                n += queue->depth.load(std::memory_order_relaxed);
+            }
+
+            return n;
+        }
+
+        /**
+         * @brief Get the number of tasks run so far.
+         */
+        std::uint64_t executed_count() const noexcept
+        {
+            return executed.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of tasks moved to another context than the one they were queued on.
+         */
+        std::uint64_t stolen_count() const noexcept
+        {
+            return stolen.load(std::memory_order_relaxed);
+        }
+    private:
+        /**
+         * @brief The deque of one context, with the flag of the run posted to it.
+         */
+        struct worker_queue
+        {
+            explicit worker_queue(asio_context& context)
+                : context(context)
+                , depth(0)
+                , scheduled(false)
+                , live(true)
+            {
+            }
+
+            asio_context&                               context;
+            std::mutex                                  mutex;
+            std::deque<task_type>                       tasks;
+            std::atomic_size_t                          depth;
+            std::atomic_bool                            scheduled;
+            bool                                        live;                                       // in the pool, under the executor's lock
+        };
+
+        /**
+         * @brief Follow the pool, see `asio_context_thread_pool::watch`.
+         * @note A deque is never removed, the runs posted to a retired context before keep it running until they have
+         *       emptied its deque. Posting waits for this, so no task is queued there afterwards.
+         */
+        void update(asio_context& context, bool joined)
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            auto it = std::find_if(queues.begin(), queues.end(), [&] (const std::unique_ptr<worker_queue>& queue) {
+                return std::addressof(queue->context) == std::addressof(context);
+            });
+
+            if (it == queues.end())
+            {
+                if (!joined)
+                {
+                    return;
+                }
+
+                it = queues.emplace(queues.end(), std::make_unique<worker_queue>(context));
+            }
+
+            (*it)->live = joined;
+            members.clear();
+
+            for (std::size_t i = 0; i < queues.size(); ++i)
+            {
+                if (queues[i]->live)
+                {
+                    members.emplace_back(i);
+                }
+            }
+        }
+
+        /**
+         * @brief Get the index of the pool context running on the calling thread, or the number of contexts if none is.
+         * @note Like every access to the deques below, it needs the executor's lock.
+         */
+        std::size_t local() const noexcept
+        {
+            asio_context* current = asio_context::current();
+
+            for (std::size_t i = 0; current != nullptr && i < queues.size(); ++i)
+            {
+                if (std::addressof(queues[i]->context) == current)
+                {
+                    return i;
+                }
+            }
+
+            return queues.size();
+        }
+
+        /**
+         * @brief Post a run to a context unless one is already posted or running.
+         */
+        void wake(std::size_t i)
+        {
+            if (!queues[i]->scheduled.exchange(true, std::memory_order_acq_rel))
+            {
+                asio::post(queues[i]->context, [self = shared_from_this(), i] { self->run(i); });
+            }
+        }
+
+        /**
+         * @brief Wake the first sibling in the pool with no run posted, it then steals from the largest deque.
+         */
+        void wake_idle(std::size_t i)
+        {
+            for (std::size_t k = 1; k < queues.size(); ++k)
+            {
+                if (std::size_t j = (i + k) % queues.size(); queues[j]->live && !queues[j]->scheduled.load(std::memory_order_acquire))
+                {
+                    return wake(j);
+                }
+            }
+        }
+
+        /**
+         * @brief Run a slice of tasks on context `i`, its own newest first, then stolen ones.
+         * @note The run posts itself again while work is left, and otherwise clears its flag and checks once more,
+         *       so a task queued while the flag was being cleared is not missed. A retired context only empties its
+         *       own deque. The lock is not held while a task runs, which may post more.
+         */
+        void run(std::size_t i)
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            worker_queue& queue = *queues[i];
+
+            for (std::size_t n = 0; n < batch; ++n)
+            {
+                task_type task;
+
+                if (!pop(queue, task) && !(queue.live && steal(i) && pop(queue, task)))
+                {
+                    break;
+                }
+
+                lock.unlock();
+
+                try
+                {
+                    task();
+                }
+                catch (const std::exception& ex)
+                {
+                    ASIO_LOG_ERROR("%s", ex.what());
+                }
+
+                executed.fetch_add(1, std::memory_order_relaxed);
+                lock.lock();
+            }
+
+            if (queue.depth.load(std::memory_order_acquire) != 0 || (queue.live && backlog(i)))
+            {
+                asio::post(queue.context, [self = shared_from_this(), i] { self->run(i); });
+                return;
+            }
+
+            queue.scheduled.store(false, std::memory_order_release);
+
+            if (queue.depth.load(std::memory_order_acquire) != 0)
+            {
+                wake(i);
+            }
+        }
+
+        /**
+         * @brief Take the newest task of a deque.
+         */
+        static bool pop(worker_queue& queue, task_type& task)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (queue.tasks.empty())
+            {
+                return false;
+            }
+
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            queue.depth.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Check for another deque with more than one task, worth stealing from.
+         */
+        bool backlog(std::size_t i) const noexcept
+        {
+            for (std::size_t j = 0; j < queues.size(); ++j)
+            {
+                if (j != i && queues[j]->depth.load(std::memory_order_relaxed) > 1)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief Move the older half of the largest other deque to the deque of context `i`.
+         * @return Returns `true` if any task was moved.
+         */
+        bool steal(std::size_t i)
+        {
+            std::size_t victim = queues.size(), largest = 0;
+
+            for (std::size_t j = 0; j < queues.size(); ++j)
+            {
+                if (std::size_t depth = queues[j]->depth.load(std::memory_order_relaxed); j != i && depth > largest)
+                {
+                    victim = j, largest = depth;
+                }
+            }
+
+            if (victim == queues.size())
+            {
+                return false;
+            }
+
+            std::deque<task_type> taken;
+
+            {
+                std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+
+                for (std::size_t n = (queues[victim]->tasks.size() + 1) / 2; n != 0; --n)
+                {
+                    taken.emplace_back(std::move(queues[victim]->tasks.front()));
+                    queues[victim]->tasks.pop_front();
+                }
+
+                queues[victim]->depth.fetch_sub(taken.size(), std::memory_order_release);
+            }
+
+            if (taken.empty())
+            {
+                return false;
+            }
+
+            stolen.fetch_add(taken.size(), std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(queues[i]->mutex);
+
+            // The oldest tasks go to the back, to run first.
+            for (auto it = taken.rbegin(); it != taken.rend(); ++it)
+            {
+                queues[i]->tasks.emplace_back(std::move(*it));
+            }
+
+            queues[i]->depth.fetch_add(taken.size(), std::memory_order_release);
+            return true;
+        }
+    private:
+        asio_context_thread_pool&                       pool;
+        std::size_t                                     batch;
+        mutable std::shared_mutex                       mutex;                                      // guards the two vectors and `live`
+        std::vector<std::unique_ptr<worker_queue>>      queues;
+        std::vector<std::size_t>                        members;                                    // the deques of the contexts in the pool
+        std::size_t                                     key;
+        std::atomic_size_t                              next;
+        std::atomic_uint64_t                            executed;
+        std::atomic_uint64_t                            stolen;
+    };
+}
+
+#endif // __ASIO_WORK_STEALING_H__
\ No newline at end of file
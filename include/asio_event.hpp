@@ -10,10 +10,25 @@
 #include "asio/asio_context_thread.hpp"
 #include "asio/asio_context_thread_pool.hpp"
 
+#include "asio/asio_affinity.hpp"
+#include "asio/asio_backoff.hpp"
+#include "asio/asio_compression.hpp"
+#include "asio/asio_histogram.hpp"
+#include "asio/asio_log.hpp"
+#include "asio/asio_metrics.hpp"
+#include "asio/asio_rate_limit.hpp"
+#include "asio/asio_resolver_cache.hpp"
 #include "asio/asio_session.hpp"
+#include "asio/asio_shm_session.hpp"
+#include "asio/asio_socket_profile.hpp"
 #include "asio/asio_tcp_client.hpp"
+#include "asio/asio_tcp_pool.hpp"
 #include "asio/asio_tcp_server.hpp"
 #include "asio/asio_timer.hpp"
+#include "asio/asio_trace.hpp"
+#include "asio/asio_udp_server.hpp"
+#include "asio/asio_udp_session.hpp"
 #include "asio/asio_utils.hpp"
+#include "asio/asio_work_stealing.hpp"
 
 #endif // __ASIO_EVENT_H__
\ No newline at end of file
@@ -0,0 +1,35 @@
+﻿#ifndef __ASIO_TEST_H__
+#define __ASIO_TEST_H__
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#	pragma once
+#endif
+
+#include <cstdio>
+
+namespace ik::test
+{
+    /**
+     * @brief Number of failed checks, `main` returns it so ctest sees the failure.
+     */
+    inline int& failures() noexcept
+    {
+        static int count = 0;
+        return count;
+    }
+}
+
+/**
+ * @brief Check a condition, report it with its location if it does not hold, and go on.
+ */
+#define ASIO_CHECK(cond)                                                                            \
+    do                                                                                              \
+    {                                                                                               \
+        if (!(cond))                                                                                \
+        {                                                                                           \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);           \
+            ik::test::failures()++;                                                                 \
+        }                                                                                           \
+    } while (0)
+
+#endif // __ASIO_TEST_H__
\ No newline at end of file
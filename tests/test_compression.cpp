@@ -0,0 +1,58 @@
+﻿#include "asio_test.hpp"
+#include "asio_event.hpp"
+
+namespace
+{
+    using namespace ik;
+
+    /**
+     * @brief Encode `message` on one end and decode it on the other, after the ends exchanged their hellos.
+     */
+    void round_trip(const std::string& message)
+    {
+        auto options = std::make_shared<asio_compression>();
+        asio_frame_codec sender(options), receiver(options);
+        std::string hello, frame, received;
+        std::size_t messages = 0;
+
+        receiver.hello(hello);
+        ASIO_CHECK(!sender.decode(hello.data(), hello.size(), [] (const char*, std::size_t) {}));
+
+        ASIO_CHECK(!sender.encode(message, frame));
+        ASIO_CHECK(!receiver.decode(frame.data(), frame.size(), [&] (const char* data, std::size_t n) { received.assign(data, n), messages++; }));
+        ASIO_CHECK(messages == 1);
+        ASIO_CHECK(received == message);
+    }
+
+    /**
+     * @brief A message over the limit is refused by the sender, instead of sent and refused by the peer.
+     */
+    void over_limit()
+    {
+        asio_frame_codec sender(std::make_shared<asio_compression>());
+        std::string frame = "kept";
+
+        ASIO_CHECK(sender.encode(std::string(asio_frame_codec::max_frame + 1, 'x'), frame) == asio::error::message_size);
+        ASIO_CHECK(frame == "kept");
+    }
+}
+
+int main()
+{
+    std::string random(asio_frame_codec::max_frame, '\0');
+    std::uint64_t x = 88172645463325252ull;
+
+    for (char& c : random)
+    {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17, c = static_cast<char>(x);
+    }
+
+    // Exactly at the limit, compressible (sent compressed where a codec is built in) and not.
+    round_trip(std::string(asio_frame_codec::max_frame, 'x'));
+    round_trip(random);
+    round_trip("small");
+    over_limit();
+
+    std::printf("test_compression: %d failure(s)\n", ik::test::failures());
+    return ik::test::failures() == 0 ? 0 : 1;
+}
\ No newline at end of file
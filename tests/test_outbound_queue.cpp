@@ -0,0 +1,90 @@
+﻿#include "asio_test.hpp"
+#include "asio_event.hpp"
+
+namespace
+{
+    using namespace ik;
+
+    /**
+     * @brief A conflated entry that was sent must leave the key index, the empty key included.
+     */
+    void conflate_after_pop(const std::string& key)
+    {
+        asio_outbound_queue queue;
+        std::string big(4096, 'x');
+
+        ASIO_CHECK(!queue.conflate(asio_priority::normal, key, "a"));
+        ASIO_CHECK(queue.front().data == "a");
+        queue.pop_front();
+        ASIO_CHECK(queue.empty());
+
+        // The popped entry is gone, so this one is queued again rather than written into it.
+        ASIO_CHECK(!queue.conflate(asio_priority::normal, key, big));
+        ASIO_CHECK(queue.size() == 1);
+        ASIO_CHECK(queue.front().data == big);
+    }
+
+    /**
+     * @brief Values of a key replace each other in place until the entry is picked, then queue behind it.
+     */
+    void conflate_in_place()
+    {
+        asio_outbound_queue queue;
+
+        queue.emplace_back(asio_priority::normal, std::string_view("first"));
+        ASIO_CHECK(!queue.conflate(asio_priority::normal, "k", "1"));
+        ASIO_CHECK(queue.conflate(asio_priority::normal, "k", "2"));
+        ASIO_CHECK(queue.size() == 2);
+
+        queue.pop_front();
+        ASIO_CHECK(queue.front().data == "2");
+
+        // The front is being sent, a new value goes behind it.
+        ASIO_CHECK(!queue.conflate(asio_priority::normal, "k", "3"));
+        ASIO_CHECK(queue.size() == 2);
+        queue.pop_front();
+        ASIO_CHECK(queue.front().data == "3");
+    }
+
+    /**
+     * @brief A weighted lane is charged for the message it picked, even if the sender moved the buffer out before
+     *        popping it, as zero-copy does.
+     */
+    void deficit_charged_on_pick()
+    {
+        asio_outbound_queue queue;
+        asio_lane_policy policy;
+        std::string order;
+
+        policy.weighted = true, policy.weights = { 1, 1, 1 }, policy.quantum = 100;
+        queue.set_policy(policy);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            queue.emplace_back(asio_priority::normal, std::string_view(std::string(100, 'n')));
+            queue.emplace_back(asio_priority::bulk, std::string_view(std::string(100, 'b')));
+        }
+
+        while (!queue.empty())
+        {
+            asio_outbound& entry = queue.front();
+
+            order += entry.data.front();
+            std::string().swap(entry.data);
+            queue.pop_front();
+        }
+
+        ASIO_CHECK(order == "nbnbnb");
+    }
+}
+
+int main()
+{
+    conflate_after_pop("");
+    conflate_after_pop("key");
+    conflate_in_place();
+    deficit_charged_on_pick();
+
+    std::printf("test_outbound_queue: %d failure(s)\n", ik::test::failures());
+    return ik::test::failures() == 0 ? 0 : 1;
+}
\ No newline at end of file